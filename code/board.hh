@@ -0,0 +1,278 @@
+// Bitboard engine for the standard 4x4 game. A Board packs the 16 cells into
+// a uint64 as exponent nibbles, cell (x, y) lives at bits 4*(x + 4*y) and 0
+// means empty, so a row is a uint16 and every move is four table lookups.
+// Left and right index 65536 entry row tables directly, up and down index
+// tables of the same rows unpacked into columns, after a transpose.
+// Only depends on basic.h and pcg.h so it can be built outside of the game.
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+typedef uint64 Board;
+
+const int BOARD_SIZE = 4;
+const int BOARD_CELLS = BOARD_SIZE*BOARD_SIZE;
+const int BOARD_ROWS_TOTAL = 65536;
+const int BOARD_EXPONENT_MAX = 15;
+const Board BOARD_ROW_MASK = 0xffffull;
+const Board BOARD_COL_MASK = 0x000f000f000f000full;
+
+typedef enum Move {
+	MOVE_NONE,
+	MOVE_UP,
+	MOVE_DOWN,
+	MOVE_LEFT,
+	MOVE_RIGHT,
+} Move;
+
+static bool board_tables_built = 0;
+static uint16 board_row_left_table[BOARD_ROWS_TOTAL];
+static uint16 board_row_right_table[BOARD_ROWS_TOTAL];
+static Board board_col_up_table[BOARD_ROWS_TOTAL];
+static Board board_col_down_table[BOARD_ROWS_TOTAL];
+static uint32 board_row_score_table[BOARD_ROWS_TOTAL];//sum of the tiles created by merges when moving the row, the same either direction
+
+
+static uint16 board__reverse_row(uint16 row) {
+	return (row >> 12) | ((row >> 4) & 0x00f0) | ((row << 4) & 0x0f00) | (row << 12);
+}
+static Board board__unpack_col(uint16 row) {
+	Board col = row;
+	return (col | (col << 12) | (col << 24) | (col << 36)) & BOARD_COL_MASK;
+}
+
+void board_init_tables() {
+	//NOTE: must be called before any other board function, it is not thread safe so call it before starting any workers
+	if(board_tables_built) return;
+	board_tables_built = 1;
+	for_each_lt(row_i, BOARD_ROWS_TOTAL) {
+		uint32 cells[BOARD_SIZE];
+		for_each_lt(i, BOARD_SIZE) cells[i] = (row_i >> (4*i)) & 0xf;
+
+		//slide towards cell 0, each tile merges at most once per move
+		uint32 score = 0;
+		int32 target = 0;
+		uint32 moved[BOARD_SIZE] = {};
+		bool can_merge = 0;
+		for_each_lt(i, BOARD_SIZE) {
+			uint32 v = cells[i];
+			if(v == 0) continue;
+			if(can_merge && moved[target - 1] == v && v < BOARD_EXPONENT_MAX) {
+				moved[target - 1] = v + 1;
+				score += 1u << (v + 1);
+				can_merge = 0;
+			} else {
+				moved[target] = v;
+				target += 1;
+				can_merge = 1;
+			}
+		}
+		uint16 result = 0;
+		for_each_lt(i, BOARD_SIZE) result |= moved[i] << (4*i);
+
+		uint16 row = row_i;
+		uint16 rev_row = board__reverse_row(row);
+		uint16 rev_result = board__reverse_row(result);
+		board_row_left_table[row] = result;
+		board_row_right_table[rev_row] = rev_result;
+		board_col_up_table[row] = board__unpack_col(result);
+		board_col_down_table[rev_row] = board__unpack_col(rev_result);
+		board_row_score_table[row] = score;
+	}
+}
+
+
+static inline Board board_transpose(Board board) {
+	//swaps cell (x, y) with cell (y, x) by exchanging 2x2 blocks of nibbles, then the nibbles within them
+	Board a1 = board & 0xf0f00f0ff0f00f0full;
+	Board a2 = board & 0x0000f0f00000f0f0ull;
+	Board a3 = board & 0x0f0f00000f0f0000ull;
+	Board a = a1 | (a2 << 12) | (a3 >> 12);
+	Board b1 = a & 0xff00ff0000ff00ffull;
+	Board b2 = a & 0x00ff00ff00000000ull;
+	Board b3 = a & 0x00000000ff00ff00ull;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+static inline Board board_mirror(Board board) {
+	//swaps cell (x, y) with cell (3 - x, y), nibbles within bytes and then bytes within rows
+	board = ((board & 0x0f0f0f0f0f0f0f0full) << 4) | ((board >> 4) & 0x0f0f0f0f0f0f0f0full);
+	return ((board & 0x00ff00ff00ff00ffull) << 8) | ((board >> 8) & 0x00ff00ff00ff00ffull);
+}
+static inline Board board_flip(Board board) {
+	//swaps cell (x, y) with cell (x, 3 - y), rows within halves and then the halves
+	board = ((board & 0x0000ffff0000ffffull) << 16) | ((board >> 16) & 0x0000ffff0000ffffull);
+	return (board << 32) | (board >> 32);
+}
+static inline Board board__min(Board board0, Board board1) {
+	return (board0 < board1) ? board0 : board1;
+}
+static inline Board board_canonical(Board board) {
+	//the least of the board's 8 rotations and reflections, every board a symmetry maps to each other gets the same one
+	Board t = board_transpose(board);
+	Board f = board_flip(board);
+	Board tf = board_flip(t);
+	Board c = board__min(board, board_mirror(board));
+	c = board__min(c, board__min(f, board_mirror(f)));
+	c = board__min(c, board__min(t, board_mirror(t)));
+	return board__min(c, board__min(tf, board_mirror(tf)));
+}
+static inline uint64 board_hash(Board board) {
+	//a hash of board's canonical form, so all 8 of its symmetries land in the same slot of a hash table
+	return pcgf__hash64(board_canonical(board));
+}
+static inline uint16 board_row(Board board, int32 y) {
+	return (board >> (16*y)) & BOARD_ROW_MASK;
+}
+static inline uint32 board_get(Board board, int32 x, int32 y) {
+	return (board >> (4*(x + BOARD_SIZE*y))) & 0xf;
+}
+static inline Board board_set(Board board, int32 x, int32 y, uint32 v) {
+	int32 shift = 4*(x + BOARD_SIZE*y);
+	return (board & ~(0xfull << shift)) | (cast(Board, v) << shift);
+}
+
+static inline Board board_move_left(Board board) {
+	Board ret = 0;
+	for_each_lt(y, BOARD_SIZE) ret |= cast(Board, board_row_left_table[board_row(board, y)]) << (16*y);
+	return ret;
+}
+static inline Board board_move_right(Board board) {
+	Board ret = 0;
+	for_each_lt(y, BOARD_SIZE) ret |= cast(Board, board_row_right_table[board_row(board, y)]) << (16*y);
+	return ret;
+}
+static inline Board board_move_up(Board board) {
+	//after the transpose each column of the board is a row we can look up
+	Board t = board_transpose(board);
+	Board ret = 0;
+	for_each_lt(x, BOARD_SIZE) ret |= board_col_up_table[board_row(t, x)] << (4*x);
+	return ret;
+}
+static inline Board board_move_down(Board board) {
+	Board t = board_transpose(board);
+	Board ret = 0;
+	for_each_lt(x, BOARD_SIZE) ret |= board_col_down_table[board_row(t, x)] << (4*x);
+	return ret;
+}
+static inline Board board_move(Board board, int32 move) {
+	if(move == MOVE_LEFT) {
+		return board_move_left(board);
+	} else if(move == MOVE_RIGHT) {
+		return board_move_right(board);
+	} else if(move == MOVE_UP) {
+		return board_move_up(board);
+	} else if(move == MOVE_DOWN) {
+		return board_move_down(board);
+	}
+	return board;
+}
+static inline uint32 board_move_score(Board board, int32 move) {
+	//the score of a move is the sum of the tiles its merges created, so the row tables only need to know one direction
+	uint32 score = 0;
+	if(move == MOVE_LEFT || move == MOVE_RIGHT) {
+		for_each_lt(y, BOARD_SIZE) score += board_row_score_table[board_row(board, y)];
+	} else if(move == MOVE_UP || move == MOVE_DOWN) {
+		Board t = board_transpose(board);
+		for_each_lt(x, BOARD_SIZE) score += board_row_score_table[board_row(t, x)];
+	}
+	return score;
+}
+
+static inline Board board_empty_mask(Board board) {
+	//sets the low bit of every empty nibble
+	board |= board >> 2;
+	board |= board >> 1;
+	return ~board & 0x1111111111111111ull;
+}
+static inline int32 board_count_empty(Board board) {
+	return __builtin_popcountll(board_empty_mask(board));
+}
+static inline int32 board_select_bit(uint64 mask, int32 n) {
+	//index of the n-th lowest set bit of mask, n must be less than its popcount
+	#ifdef __BMI2__
+	return __builtin_ctzll(_pdep_u64(cast(uint64, 1) << n, mask));
+	#else
+	//without pdep, halve the window six times, keeping the half the bit is in by its popcount
+	int32 shift = 0;
+	for(int32 half = 32; half > 0; half /= 2) {
+		uint64 low = mask & ((cast(uint64, 1) << half) - 1);
+		int32 low_size = __builtin_popcountll(low);
+		if(n >= low_size) {
+			n -= low_size;
+			mask >>= half;
+			shift += half;
+		} else {
+			mask = low;
+		}
+	}
+	return shift;
+	#endif
+}
+Board board_spawn(Board board, PCG* rng) {
+	//matches the game's rules: a uniformly chosen empty cell, in row major order, gets a 2 or a 4 with even odds
+	Board empty = board_empty_mask(board);
+	int32 empty_size = __builtin_popcountll(empty);
+	if(empty_size == 0) return board;
+	int32 n = pcg_random_in(rng, 0, empty_size - 1);
+	Board tile = cast(Board, pcg_random_in(rng, 1, 2));
+	return board | (tile << board_select_bit(empty, n));
+}
+Board board_new_game(PCG* rng) {
+	//matches game_2048_init_grid, a game starts with one 2 or 4 in a uniformly chosen cell, drawn as the tile, then x, then y
+	uint32 v = pcg_random_in(rng, 1, 2);
+	int32 x = pcg_random_in(rng, 0, BOARD_SIZE - 1);
+	int32 y = pcg_random_in(rng, 0, BOARD_SIZE - 1);
+	return board_set(0, x, y, v);
+}
+int32 board_random_move(Board board, PCG* rng, Board* ret_moved) {
+	//a move chosen uniformly among the ones that change the board, MOVE_NONE with the board left as is once the game is over
+	int32 moves[4];
+	Board moved_boards[4];
+	int32 moves_size = 0;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		Board moved = board_move(board, move);
+		if(moved == board) continue;
+		moves[moves_size] = move;
+		moved_boards[moves_size] = moved;
+		moves_size += 1;
+	}
+	if(moves_size == 0) {
+		*ret_moved = board;
+		return MOVE_NONE;
+	}
+	int32 i = pcg_random_in(rng, 0, moves_size - 1);
+	*ret_moved = moved_boards[i];
+	return moves[i];
+}
+static inline bool board_is_game_over(Board board) {
+	if(board_empty_mask(board)) return 0;
+	//a full board can still move if two neighbours are equal, which shows up as a zero nibble in the xor with its shifted self
+	Board horizontal = board ^ (board >> 4);
+	Board vertical = board ^ (board >> 16);
+	//except for neighbours at BOARD_EXPONENT_MAX, which the move tables don't merge, so they are masked out where the board's nibble is 0xf
+	Board capped = board_empty_mask(~board);
+	Board horizontal_pairs = board_empty_mask(horizontal) & ~capped & 0x0111011101110111ull;
+	Board vertical_pairs = board_empty_mask(vertical) & ~capped & 0x0000111111111111ull;
+	return !(horizontal_pairs | vertical_pairs);
+}
+static inline uint32 board_max_exponent(Board board) {
+	uint32 ret = 0;
+	for_each_lt(i, BOARD_CELLS) {
+		uint32 v = (board >> (4*i)) & 0xf;
+		if(v > ret) ret = v;
+	}
+	return ret;
+}
+
+Board board_pack(int32* grid) {
+	Board board = 0;
+	for_each_lt(i, BOARD_CELLS) {
+		int32 v = grid[i] < BOARD_EXPONENT_MAX ? grid[i] : BOARD_EXPONENT_MAX;
+		board |= cast(Board, v) << (4*i);
+	}
+	return board;
+}
+void board_unpack(Board board, int32* grid) {
+	for_each_lt(i, BOARD_CELLS) grid[i] = (board >> (4*i)) & 0xf;
+}
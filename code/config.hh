@@ -18,6 +18,7 @@
 static char* MVK_DEVICE_EXTENSIONS[MVK_DEVICE_EXTENSIONS_SIZE] = {"VK_KHR_swapchain"};
 #define MVK_SHADER_FRAG "frag.spv"
 #define MVK_SHADER_VERT "vert.spv"
+#define MVK_SHADER_BOARDS_VERT "boards_vert.spv"
 #define MVK_FRAMES_IN_FLIGHT 2
 
 #define DEFAULT_SCREEN_WIDTH 1200
@@ -26,19 +27,46 @@ static char* MVK_DEVICE_EXTENSIONS[MVK_DEVICE_EXTENSIONS_SIZE] = {"VK_KHR_swapch
 #ifdef DEBUG
 	#define PEDAL_TO_THE_METAL 0
 	#define FPS_PRINTOUT_FREQUENCY 1024
+	#define GAME_HOT_RELOAD 1
 #else
 	#define PEDAL_TO_THE_METAL 0
 	#define FPS_PRINTOUT_FREQUENCY 0
+	#define GAME_HOT_RELOAD 0
+#endif
+#ifdef _WIN32
+	#define GAME_MODULE_FILENAME "game_module.dll"
+#else
+	#define GAME_MODULE_FILENAME "./game_module.so"
 #endif
 
 const int VERTEX_BUFFER_SIZE = MEGABYTE;
 const int INDEX_BUFFER_SIZE = MEGABYTE;
+const int INSTANCE_BUFFER_SIZE = MEGABYTE;
+const int WALL_SIZE_MAX = INSTANCE_BUFFER_SIZE/sizeof(Board);//the whole wall has to fit in one frame's instance buffer
 
-const inta TEMP_STACK_SIZE = MEGABYTE;
+const inta TEMP_STACK_SIZE = 256*MEGABYTE;//reserved, only the part the stack has grown over takes up memory
+const inta MVK_STACK_SIZE = 64*MEGABYTE;//reserved like the temp stack
 const inta GAME_STACK_SIZE = MEGABYTE;
+const int DEFAULT_GRID_SIZE = 4;
+const float SOLVER_TIME_BUDGET = 0.1f;//the solver runs on its own thread, this only bounds how long autoplay waits between moves past SOLVER_DEPTH_MIN
+const int SOLVER_TABLE_SIZE_LOG2 = 22;
+const int MONTECARLO_ROLLOUTS_MIN = 4096;//per move, every search plays at least this many however long they take
+const float MONTECARLO_TIME_BUDGET = 0.1f;//it runs on its own thread, past the minimum it plays more rollouts while this allows
+const int GRID_SIZE_MAX = 4096;
+const int TWEEN_TILES_MAX = 65536;//moves on grids with more tiles than this aren't animated
+const int HISTORY_CAPACITY_START = 4096;//moves, the log doubles whenever it fills up
 const float MAX_UPDATE_DELTA = .5;
 const float DELAY_RESOLUTION = 0.0005;
 const float DEFAULT_FPS = (1.0f/60.0f);
+const uint64 DEFAULT_SEED = 12;
+#define SAVE_QUICK_FILENAME "quick.sav"
+const int EVENTS_PER_FRAME_MAX = 64;
+const float PRESENT_INTERVAL_MIN_RATIO = 0.25f;//measured refresh intervals outside of these ratios of the display mode's interval are treated as noise
+const float PRESENT_INTERVAL_MAX_RATIO = 4.0f;
+const float PRESENT_MISSED_RATIO = 1.5f;//a present interval this many times longer than the refresh interval means we missed a vsync
+const float PRESENT_SLACK_TARGET = 0.0015f;//how long before its vsync deadline we aim to have a frame ready
+const float PRESENT_SLACK_GAIN = 0.125f;
+const int PRESENT_TIMINGS_MAX = 8;
 
 
 // VK_KHR_surface
@@ -0,0 +1,157 @@
+// The batched environment of env.h. The games of a batch are parallel
+// arrays of boards and rngs, stepped a chunk at a time on the job
+// pool. A step of a board is the same board.hh move and spawn the game
+// uses, row table lookups and a handful of bit tricks on one uint64, and
+// every board draws from its own pcg stream, so how a batch is split into
+// chunks never changes what its games do.
+//
+// Build it with -shared -fvisibility=hidden, so the env.h functions are all
+// it exports.
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+
+#define min gb_min
+#define max gb_max
+
+#include "board.hh"
+#include "jobs.hh"
+#include "env.h"
+
+#ifdef _WIN32
+	#define ENV_EXPORT extern "C" __declspec(dllexport)
+#else
+	#define ENV_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+const int ENV_CHUNK_SIZE = 1024;//boards per task, batches of at most one chunk are stepped without waking the pool
+
+struct EnvBatch {
+	int32 size;
+	uint64 seed;
+	JobPool jobs;
+	Board* boards;
+	PCG* rngs;
+
+	//the current call's arguments
+	const uint8* actions;
+	float* rewards;
+	uint8* dones;
+	uint64* obs;
+	uint8* masks;
+};
+
+
+static void env__run(EnvBatch* batch, JobFunc* func) {
+	int32 tasks = (batch->size + ENV_CHUNK_SIZE - 1)/ENV_CHUNK_SIZE;
+	if(tasks == 1) {
+		func(batch, 0, 0);
+	} else {
+		jobs_run(&batch->jobs, func, batch, tasks);
+	}
+}
+
+static void env__reset_task(void* data, int32 task_i, int32 worker_i) {
+	EnvBatch* batch = (EnvBatch*)data;
+	int32 first = task_i*ENV_CHUNK_SIZE;
+	int32 end = min(first + ENV_CHUNK_SIZE, batch->size);
+	for(int32 i = first; i < end; i += 1) {
+		batch->boards[i] = board_new_game(&batch->rngs[i]);
+		batch->obs[i] = batch->boards[i];
+	}
+}
+
+static void env__step_task(void* data, int32 task_i, int32 worker_i) {
+	EnvBatch* batch = (EnvBatch*)data;
+	int32 first = task_i*ENV_CHUNK_SIZE;
+	int32 end = min(first + ENV_CHUNK_SIZE, batch->size);
+	Board* boards = batch->boards;
+	PCG* rngs = batch->rngs;
+	for(int32 i = first; i < end; i += 1) {
+		Board board = boards[i];
+		int32 move = MOVE_UP + (batch->actions[i]&3);
+		Board moved = board_move(board, move);
+		bool has_moved = moved != board;
+		batch->rewards[i] = has_moved ? board_move_score(board, move) : 0;
+		if(has_moved) moved = board_spawn(moved, &rngs[i]);
+		bool is_done = has_moved && board_is_game_over(moved);
+		if(is_done) {
+			//the game's rng carries on into its next game, which keeps the stream of every board independent of the others
+			moved = board_new_game(&rngs[i]);
+		}
+		batch->dones[i] = is_done;
+		boards[i] = moved;
+		batch->obs[i] = moved;
+	}
+}
+
+static void env__legal_actions_task(void* data, int32 task_i, int32 worker_i) {
+	EnvBatch* batch = (EnvBatch*)data;
+	int32 first = task_i*ENV_CHUNK_SIZE;
+	int32 end = min(first + ENV_CHUNK_SIZE, batch->size);
+	for(int32 i = first; i < end; i += 1) {
+		Board board = batch->boards[i];
+		uint8 mask = 0;
+		for_each_lt(a, ENV_ACTIONS_SIZE) mask |= (board_move(board, MOVE_UP + a) != board) << a;
+		batch->masks[i] = mask;
+	}
+}
+
+
+ENV_EXPORT EnvBatch* env_batch_new(int32_t size, uint64_t seed, int32_t threads) {
+	if(size <= 0) return 0;
+	board_init_tables();
+	if(threads < 1) threads = jobs_cpu_count();
+	EnvBatch* batch = malloct(EnvBatch, 1);
+	memzero(batch, 1);
+	batch->size = size;
+	batch->seed = seed;
+	batch->boards = malloct(Board, size);
+	batch->rngs = malloct(PCG, size);
+	for_each_lt(i, size) {
+		pcg_seeds(&batch->rngs[i], seed, i);
+		batch->boards[i] = board_new_game(&batch->rngs[i]);
+	}
+	//a pool too big for the batch would only have its workers wake up to nothing
+	int32 tasks = (size + ENV_CHUNK_SIZE - 1)/ENV_CHUNK_SIZE;
+	jobs_init(&batch->jobs, min(threads, tasks) - 1);
+	return batch;
+}
+ENV_EXPORT void env_batch_free(EnvBatch* batch) {
+	if(!batch) return;
+	jobs_term(&batch->jobs);
+	free(batch->boards);
+	free(batch->rngs);
+	free(batch);
+}
+ENV_EXPORT int32_t env_batch_size(EnvBatch* batch) {
+	return batch->size;
+}
+
+ENV_EXPORT void env_batch_reset(EnvBatch* batch, uint64_t* obs) {
+	batch->obs = cast(uint64*, obs);
+	env__run(batch, env__reset_task);
+	batch->obs = 0;
+}
+ENV_EXPORT void env_batch_step(EnvBatch* batch, const uint8_t* actions, float* rewards, uint8_t* dones, uint64_t* obs) {
+	batch->actions = actions;
+	batch->rewards = rewards;
+	batch->dones = dones;
+	batch->obs = cast(uint64*, obs);
+	env__run(batch, env__step_task);
+	batch->actions = 0;
+	batch->rewards = 0;
+	batch->dones = 0;
+	batch->obs = 0;
+}
+ENV_EXPORT void env_batch_legal_actions(EnvBatch* batch, uint8_t* masks) {
+	batch->masks = masks;
+	env__run(batch, env__legal_actions_task);
+	batch->masks = 0;
+}
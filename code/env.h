@@ -0,0 +1,50 @@
+// C interface to batches of 2048 games for reinforcement learning, built
+// from env.cc into a shared library that depends on neither SDL nor Vulkan.
+// A batch steps every one of its games with one call, split between the
+// threads of its own pool, and every array passed in is the caller's: the
+// new boards are written straight into obs, so a caller can hand over the
+// memory of its own tensors and nothing gets copied twice.
+//
+// An observation is a board as a uint64 of 16 nibbles, the exponent of the
+// tile at (x, y) in bits 4*(x + 4*y) and 0 for an empty cell. An action is
+// one of the ENV_ACTION values. An action that doesn't change its board
+// gets a reward of 0 and leaves the board as it is, without a spawn. A game
+// that ends with a step is replaced by a new one in that same step, it is
+// flagged in dones and the first board of the new game is what obs gets.
+#ifndef ENV_H
+#define ENV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	ENV_ACTION_UP,
+	ENV_ACTION_DOWN,
+	ENV_ACTION_LEFT,
+	ENV_ACTION_RIGHT,
+	ENV_ACTIONS_SIZE,
+};
+
+typedef struct EnvBatch EnvBatch;
+
+//threads counts the calling thread, 0 uses every core
+//game i of a batch always plays the same games for the same seed, whatever the batch's size or threads
+EnvBatch* env_batch_new(int32_t size, uint64_t seed, int32_t threads);
+void env_batch_free(EnvBatch* batch);
+int32_t env_batch_size(EnvBatch* batch);
+
+//starts a new game on every board, obs gets size boards
+void env_batch_reset(EnvBatch* batch, uint64_t* obs);
+//actions, rewards, dones and obs all hold size entries
+void env_batch_step(EnvBatch* batch, const uint8_t* actions, float* rewards, uint8_t* dones, uint64_t* obs);
+//masks gets a bit for every action that would change its board, bit i for action i
+void env_batch_legal_actions(EnvBatch* batch, uint8_t* masks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,614 @@
+// The game itself: its memory, how it updates from input and how it renders
+// into a frame's vertex buffers. It never calls SDL's window functions or
+// Vulkan, so besides being included by main.cc it is built on its own into
+// the reloadable game module by game_module.cc. Everything the game keeps
+// between frames has to live in the GameMemDesc tree, statics don't survive
+// a reload.
+
+void game_free_recursively(GameMemDesc* desc) {
+	//a TEMP child of a loaded game has no memory until game_alloc_temp runs, a save can be rejected before that
+	if(!desc->mem) return;
+	for_each_lt(i, desc->children_total) {
+		GameMemDesc* child = &cast(GameMemDesc*, desc->mem)[i];
+
+		if(!(child->flags & GAME_MEMDESC_INTERNAL)) {
+			game_free_recursively(child);
+		}
+	}
+	if(desc->flags & GAME_MEMDESC_MAPPING) {
+		save_unmap(desc);
+	} else if(desc->flags & GAME_MEMDESC_VIRTUAL) {
+		vstack_free(cast(MamStack*, desc->mem));
+	} else if(!(desc->flags & GAME_MEMDESC_MAPPED)) {
+		if(desc->flags & GAME_MEMDESC_HUGE) {
+			huge_free(desc->mem, desc->alloc_size);
+		} else {
+			free(desc->mem);
+		}
+	}
+	desc->mem = 0;
+}
+//NOTE: all memory for the game's internals should be allocated through this function
+GameMemDesc alloc_game_mem(inta alloc_size, int children_total, uint flags) {
+	//a GAME_MEMDESC_VIRTUAL allocation comes back as an empty MamStack with alloc_size reserved for it
+	//a GAME_MEMDESC_HUGE one comes back with the flag of the huge pages it got, if any, see game_mem_backing_name
+	GameMemDesc desc;
+	desc.alloc_size = alloc_size;
+	desc.children_total = children_total;
+	desc.flags = flags & ~(GAME_MEMDESC_HUGE_TRANSPARENT | GAME_MEMDESC_HUGE_EXPLICIT);
+	if(flags & GAME_MEMDESC_VIRTUAL) {
+		desc.mem = vstack_new(alloc_size);
+		return desc;
+	}
+	if(flags & GAME_MEMDESC_HUGE) {
+		int32 backing;
+		desc.mem = huge_alloc(alloc_size, &backing);
+		if(backing == HUGE_BACKING_TRANSPARENT) desc.flags |= GAME_MEMDESC_HUGE_TRANSPARENT;
+		if(backing == HUGE_BACKING_EXPLICIT) desc.flags |= GAME_MEMDESC_HUGE_EXPLICIT;
+	} else {
+		desc.mem = malloc(alloc_size);
+	}
+	#ifdef DEBUG
+		memset(desc.mem, ~((char)0), alloc_size);
+	#endif
+	return desc;
+}
+
+const char* game_mem_backing_name(GameMemDesc* desc) {
+	if(desc->flags & GAME_MEMDESC_HUGE_EXPLICIT) return huge_backing_name(HUGE_BACKING_EXPLICIT);
+	if(desc->flags & GAME_MEMDESC_HUGE_TRANSPARENT) return huge_backing_name(HUGE_BACKING_TRANSPARENT);
+	if(desc->flags & GAME_MEMDESC_VIRTUAL) return "reserved virtual memory";
+	if(desc->flags & GAME_MEMDESC_MAPPED) return "a mapped save file";
+	return huge_backing_name(HUGE_BACKING_SMALL);
+}
+
+static bool game_uses_board(Game* game) {
+	return game->grid_w == BOARD_SIZE && game->grid_h == BOARD_SIZE;
+}
+void game_2048_init_grid(Game* game) {
+	memzero(game->grid, game->grid_h*game->grid_w);
+	int32 v = pcg_random_in(&game->rng, 1, 2);
+	int32 x = pcg_random_in(&game->rng, 0, game->grid_w - 1);
+	int32 y = pcg_random_in(&game->rng, 0, game->grid_h - 1);
+	game->grid[x + game->grid_w*y] = v;
+	grid_empty_build(game->grid_empty, game->grid, game->grid_w, game->grid_h);
+	tweens_clear(game->tweens);
+	if(game_uses_board(game)) {
+		game->board = board_pack(game->grid);
+		history_init(game->history, game->history->capacity, game->board);
+	}
+}
+static void game_history_push(Game* game, int32 move, Board moved, Board spawned) {
+	if(history_push(game->history, move, moved, spawned)) return;
+	//the log is full, so it moves to an allocation twice the size
+	int32 capacity = 2*game->history->capacity;
+	GameMemDesc desc = alloc_game_mem(history_alloc_size(capacity), 0, 0);
+	history_init(cast(History*, desc.mem), capacity, 0);
+	history_copy(cast(History*, desc.mem), game->history);
+	game_free_recursively(&game->history_desc);
+	game->history_desc = desc;
+	history_push(game->history, move, moved, spawned);
+}
+static uint game_grid_mem_flags(int32 grid_w, int32 grid_h) {
+	//a grid of a huge page or more goes on huge pages, where every row of an up or down move's transpose is on a different small page
+	//a smaller grid stays on malloc, it would take up a whole huge page for itself
+	return (cast(inta, grid_w)*grid_h*sizeof(int32) >= HUGE_PAGE_SIZE) ? GAME_MEMDESC_HUGE : 0;
+}
+static void game_alloc_temp(Game* game) {
+	//allocates the children that aren't saved, for a new game and for one that was just loaded
+	game->temp_stack_desc = alloc_game_mem(TEMP_STACK_SIZE, 0, GAME_MEMDESC_TEMP | GAME_MEMDESC_STACK | GAME_MEMDESC_VIRTUAL);
+	game->grid_scratch_desc = alloc_game_mem(game->grid_w*game->grid_h*sizeof(int32), 0, GAME_MEMDESC_TEMP | game_grid_mem_flags(game->grid_w, game->grid_h));
+	//every tile can slide and half of them can merge into a new one, plus the spawn, past TWEEN_TILES_MAX tiles moves just snap
+	int32 tweens_capacity = 3*min(game->grid_w*game->grid_h, TWEEN_TILES_MAX)/2 + 1;
+	game->tweens_desc = alloc_game_mem(tweens_alloc_size(tweens_capacity), 0, GAME_MEMDESC_TEMP);
+	tweens_init(game->tweens, tweens_capacity);
+}
+GameMemDesc game_new(uint64 seed, int32 grid_w, int32 grid_h) {
+	GameMemDesc game_mem_desc = alloc_game_mem(GAME_STACK_SIZE, 8, 0);
+
+	Game* game = (Game*)game_mem_desc.mem;
+	memzero(game, 1);
+
+	game->stack_desc.mem = ptr_add(void, game, sizeof(Game));
+	game->stack_desc.alloc_size = GAME_STACK_SIZE - sizeof(Game);
+	game->stack_desc.children_total = 0;
+	game->stack_desc.flags = GAME_MEMDESC_INTERNAL | GAME_MEMDESC_STACK;
+	mam_stack_init(game->stack_desc.mem, game->stack_desc.alloc_size);
+
+	//grids can be far bigger than the game stack, so they get their own allocations
+	game->grid_w = grid_w;
+	game->grid_h = grid_h;
+	game->grid_desc = alloc_game_mem(grid_w*grid_h*sizeof(int32), 0, game_grid_mem_flags(grid_w, grid_h));
+	game->grid_empty_desc = alloc_game_mem(grid_empty_alloc_size(grid_w, grid_h), 0, 0);
+	game_alloc_temp(game);
+	game->history_desc = alloc_game_mem(history_alloc_size(HISTORY_CAPACITY_START), 0, 0);
+	history_init(game->history, HISTORY_CAPACITY_START, 0);
+	game->wall_desc = alloc_game_mem(wall_alloc_size(0), 0, 0);
+	wall_init(game->wall, 0, 0);
+
+	pcg_seed(&game->rng, seed);
+	board_init_tables();
+	grid_init();
+
+	game->lifetime = 0.0;
+	game->do_draw = 1;
+	game->autoplay = 0;
+	game->autoplayer = AUTOPLAYER_EXPECTIMAX;
+	game->hint_move = MOVE_NONE;
+
+	{//init game state
+		game->colors_size = 12;
+		game->colors = mam_stack_pusht(gbVec3, game->stack, game->colors_size);
+		game->colors[0] = {1.0f, 1.0f, 1.0f};
+		for_each_in_range(i, 1, game->colors_size - 1) {
+			float t = (i - 1.0f)/(game->colors_size - 2.0f);
+			if(t <= .5) {
+				t *= 2;
+				game->colors[i].r = t;
+				game->colors[i].g = 0.05;
+				game->colors[i].b = 1.0f - t;
+			} else {
+				t = 2*t - 1;
+				game->colors[i].r = 1.0f - t;
+				game->colors[i].g = t;
+				game->colors[i].b = 0.05;
+			}
+		}
+
+		game->state = GAME_STATE_2048;
+
+		game_2048_init_grid(game);
+	}
+
+	return game_mem_desc;
+}
+void game_set_wall(Game* game, int32 size, uint64 seed) {
+	//replaces the wall with size new games, the game itself comes back once the size is 0
+	game_free_recursively(&game->wall_desc);
+	game->wall_desc = alloc_game_mem(wall_alloc_size(size), 0, 0);
+	wall_init(game->wall, size, seed);
+}
+bool game_load(const char* filename, GameMemDesc* ret_game_desc) {
+	//the game is used in place from the mapped save, only the unsaved children get allocated
+	GameMemDesc game_mem_desc;
+	if(!save_map(filename, &game_mem_desc)) return 0;
+	Game* game = (Game*)game_mem_desc.mem;
+	inta grid_size = cast(inta, game->grid_w)*game->grid_h;
+	if(game->grid_w < 2 || game->grid_h < 2 || game->grid_w > GRID_SIZE_MAX || game->grid_h > GRID_SIZE_MAX || game->grid_desc.alloc_size != grid_size*cast(inta, sizeof(int32)) || game->grid_empty_desc.alloc_size != grid_empty_alloc_size(game->grid_w, game->grid_h)) {
+		printf("Invalid save file: %s\n", filename);
+		game_free_recursively(&game_mem_desc);
+		return 0;
+	}
+	if(game->history_desc.alloc_size < cast(inta, sizeof(History)) || game->history_desc.alloc_size != history_alloc_size(game->history->capacity) || game->history->size > game->history->capacity || game->history->at > game->history->size
+	|| game->wall_desc.alloc_size < cast(inta, sizeof(Wall)) || game->wall->size < 0 || game->wall->size > WALL_SIZE_MAX || game->wall_desc.alloc_size != wall_alloc_size(game->wall->size)) {
+		printf("Invalid save file: %s\n", filename);
+		game_free_recursively(&game_mem_desc);
+		return 0;
+	}
+	//colors is the only pointer in the game that isn't a child GameMemDesc, it points into the game stack
+	game->colors = cast(gbVec3*, save_rebase(&game_mem_desc, game->colors));
+	game_alloc_temp(game);
+	board_init_tables();
+	grid_init();
+	*ret_game_desc = game_mem_desc;
+	return 1;
+}
+
+//whether game_update's behaviour depends on delta this frame, used to keep replays compact
+bool game_uses_delta(Game* game) {
+	return game->state == GAME_STATE_GAME_OVER;
+}
+
+Output game_update(Game* game, SDL_Event* events, int32 events_size, double delta) {
+	Output output = {};
+
+	{//clear transient data
+		mam_stack_set_size(game->temp_stack, 0);
+		game->input_left_just_down = 0;
+		game->input_right_just_down = 0;
+		game->input_up_just_down = 0;
+		game->input_down_just_down = 0;
+		game->input_hint_just_down = 0;
+		game->input_history_jump = -1;
+		game->input_timestamp = 0;
+	}
+
+	for_each_in(SDL_Event, event_ptr, events, events_size) {
+		SDL_Event event = *event_ptr;
+		if(event.type == SDL_QUIT) {
+			output.game_quit = 1;
+			break;
+		} else if(event.type == SDL_TEXTINPUT) {
+		} else if(event.type == SDL_TEXTEDITING) {
+		} else if(event.type == SDL_MOUSEMOTION) {
+		} else if(event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP) {
+			if(event.button.button == SDL_BUTTON_LEFT) {
+			} else if(event.button.button == SDL_BUTTON_RIGHT) {
+			} else if(event.button.button == SDL_BUTTON_MIDDLE) {
+			}
+		} else if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+			auto scancode = event.key.keysym.scancode;
+			auto keycode = event.key.keysym.sym;
+			bool is_down = (event.key.state == SDL_PRESSED);
+			bool is_repeat = (event.key.repeat > 0);
+			//TODO: Support full suite of keys
+			if(is_down) {
+				if(keycode == SDLK_ESCAPE) {
+					output.game_quit = 1;
+					break;
+					// } else if(keycode == SDLK_BACKSPACE) {
+					// 	input_add_char(&input, CHAR_BACKSPACE, startup_stack);
+					// } else if(keycode == SDLK_DELETE) {
+					// 	input_add_char(&input, CHAR_DELETE, startup_stack);
+					// } else if(keycode == SDLK_TAB) {
+					// 	input_add_char(&input, CHAR_TAB, startup_stack);
+					// } else if(keycode == SDLK_RETURN) {
+					// 	//NOTE: there's a SDLK_RETURN2??
+					// 	input_add_char(&input, CHAR_RETURN, startup_stack);
+					// } else if(keycode == SDLK_DOWN) {
+					// 	input_add_char(&input, CHAR_DOWN, startup_stack);
+					// } else if(keycode == SDLK_UP) {
+					// 	input_add_char(&input, CHAR_UP, startup_stack);
+					// } else if(keycode == SDLK_RIGHT) {
+					// 	input_add_char(&input, CHAR_RIGHT, startup_stack);
+					// } else if(keycode == SDLK_LEFT) {
+					// 	//NOTE: there's a SDLK_RETURN2??
+					// 	input_add_char(&input, CHAR_LEFT, startup_stack);
+				} else {
+				}
+			} else {
+			}
+			if(!is_repeat) {
+				if(is_down && (!game->input_timestamp || event.key.timestamp < game->input_timestamp)) {
+					game->input_timestamp = event.key.timestamp;
+				}
+				if(keycode == SDLK_LEFT) {
+					game->input_left_just_down |= is_down & !game->input_left_down;
+					game->input_left_down = is_down;
+				} else if(keycode == SDLK_RIGHT) {
+					game->input_right_just_down |= is_down & !game->input_right_down;
+					game->input_right_down = is_down;
+				} else if(keycode == SDLK_UP) {
+					game->input_up_just_down |= is_down & !game->input_up_down;
+					game->input_up_down = is_down;
+				} else if(keycode == SDLK_DOWN) {
+					game->input_down_just_down |= is_down & !game->input_down_down;
+					game->input_down_down = is_down;
+				} else if(keycode == SDLK_h) {
+					game->input_hint_just_down |= is_down;
+				} else if(keycode == SDLK_a) {
+					if(is_down) game->autoplay = !game->autoplay;
+				} else if(keycode == SDLK_m) {
+					if(is_down) {
+						game->autoplayer = (game->autoplayer + 1)%AUTOPLAYERS_SIZE;
+						game->hint_move = MOVE_NONE;
+					}
+				} else if(keycode == SDLK_z || keycode == SDLK_y) {
+					//undo and redo step from wherever an earlier key this frame already jumped to
+					if(is_down) {
+						int32 at = (game->input_history_jump >= 0) ? game->input_history_jump : game->history->at;
+						game->input_history_jump = max(at + ((keycode == SDLK_y) ? 1 : -1), 0);
+					}
+				} else if(keycode == SDLK_HOME) {
+					if(is_down) game->input_history_jump = 0;
+				} else if(keycode == SDLK_END) {
+					if(is_down) game->input_history_jump = game->history->size;
+				} else if(keycode == SDLK_F5) {
+					output.save_game |= is_down;
+				} else if(keycode == SDLK_F9) {
+					output.load_game |= is_down;
+				} else if(keycode == SDLK_LSHIFT) {
+				} else if(keycode == SDLK_LCTRL) {
+				} else if(keycode >= SDLK_0 && keycode <= SDLK_9) {
+					//jumps through the history in ninths, 0 is the first move and 9 the last
+					if(is_down) game->input_history_jump = game->history->size*(keycode - SDLK_0)/9;
+				}
+			}
+		} else if (event.type == SDL_WINDOWEVENT) {
+			auto window_id = event.window.event;
+			if (window_id == SDL_WINDOWEVENT_CLOSE) {
+				output.game_quit = 1;
+				break;
+			} else if(window_id == SDL_WINDOWEVENT_SIZE_CHANGED) {
+				output.window_resize = 1;
+			#if SDL_VERSION_ATLEAST(2, 0, 18)
+			} else if(window_id == SDL_WINDOWEVENT_DISPLAY_CHANGED) {
+				output.display_change = 1;
+			#endif
+			} else if (window_id == SDL_WINDOWEVENT_SHOWN) {
+				game->do_draw = 1;
+			} else if (window_id == SDL_WINDOWEVENT_HIDDEN) {
+				game->do_draw = 0;
+			} else if (window_id == SDL_WINDOWEVENT_MINIMIZED) {
+				game->do_draw = 0;
+			} else if (window_id == SDL_WINDOWEVENT_MAXIMIZED) {
+			} else if (window_id == SDL_WINDOWEVENT_EXPOSED) {
+				game->do_draw = 1;
+			} else if (window_id == SDL_WINDOWEVENT_ENTER) {
+			} else if (window_id == SDL_WINDOWEVENT_LEAVE) {
+			} else if (window_id == SDL_WINDOWEVENT_FOCUS_GAINED) {
+			} else if (window_id == SDL_WINDOWEVENT_FOCUS_LOST) {
+			}
+		}
+	}
+	if(output.game_quit) return output;
+
+	if(game->wall->size > 0) {//the wall replaces the game, every one of its boards moves once a frame
+		wall_step(game->wall);
+		game->lifetime += delta;
+		output.do_draw = game->do_draw;
+		return output;
+	}
+
+	if(game->input_history_jump >= 0 && game_uses_board(game)) {//undo, redo or jump
+		Board board = history_jump(game->history, game->input_history_jump);
+		game->board = board;
+		board_unpack(board, game->grid);
+		grid_empty_build(game->grid_empty, game->grid, game->grid_w, game->grid_h);
+		tweens_clear(game->tweens);
+		game->hint_move = MOVE_NONE;
+		game->state = board_is_game_over(board) ? GAME_STATE_GAME_OVER : GAME_STATE_2048;
+		game->game_over_timer = 0;
+		output.input_timestamp = game->input_timestamp;
+	}
+
+	if(game->state == GAME_STATE_2048) {//update game
+		int32 move = MOVE_NONE;
+		if(game->input_left_just_down) {
+			move = MOVE_LEFT;
+		} else if(game->input_right_just_down) {
+			move = MOVE_RIGHT;
+		} else if(game->input_up_just_down) {
+			move = MOVE_UP;
+		} else if(game->input_down_just_down) {
+			move = MOVE_DOWN;
+		}
+		if(move != MOVE_NONE) {
+			//the tweens follow the tiles of the grid as it is before the move, a move that changes nothing ends the running animation
+			tweens_begin_move(game->tweens, game->grid, game->grid_w, game->grid_h, move, game_uses_board(game));
+		}
+		bool has_cell_moved = 0;
+		bool is_game_over = 0;
+		if(game_uses_board(game)) {
+			Board board = board_move(game->board, move);
+			if(board != game->board) {
+				has_cell_moved = 1;
+				Board spawned = board_spawn(board, &game->rng);
+				if(spawned != board) {
+					int32 cell = __builtin_ctzll(spawned ^ board)/4;
+					tweens_add_spawn(game->tweens, cell%BOARD_SIZE, cell/BOARD_SIZE, board_get(spawned, cell%BOARD_SIZE, cell/BOARD_SIZE));
+					game_history_push(game, move, board, spawned);
+				}
+				is_game_over = board_is_game_over(spawned);
+				game->board = spawned;
+				board_unpack(spawned, game->grid);
+			}
+		} else if(move != MOVE_NONE) {
+			has_cell_moved = grid_move(game->grid, game->grid_scratch, game->grid_empty, game->grid_w, game->grid_h, move);
+			if(has_cell_moved) {
+				int32 cell = grid_spawn(game->grid, game->grid_empty, &game->rng);
+				if(cell >= 0) tweens_add_spawn(game->tweens, cell%game->grid_w, cell/game->grid_w, game->grid[cell]);
+				is_game_over = grid_is_game_over(game->grid, game->grid_empty);
+			}
+		}
+		if(has_cell_moved) {
+			output.input_timestamp = game->input_timestamp;
+			game->hint_move = MOVE_NONE;
+			if(is_game_over) {
+				game->state = GAME_STATE_GAME_OVER;
+				game->game_over_timer = 0;
+			}
+		}
+		bool can_search = game_uses_board(game) || tablebase_shape_is_valid(game->grid_w, game->grid_h);
+		if(can_search && game->state == GAME_STATE_2048 && (game->input_hint_just_down || game->autoplay)) {
+			output.search_move = game->hint_move == MOVE_NONE;
+		}
+	} else if(game->state == GAME_STATE_GAME_OVER) {
+		if(game->game_over_timer >= 1.5) {
+			if(game->input_down_just_down | game->input_up_just_down | game->input_left_just_down | game->input_right_just_down) {
+				game->state = GAME_STATE_2048;
+				game_2048_init_grid(game);
+				game->hint_move = MOVE_NONE;
+				output.input_timestamp = game->input_timestamp;
+			}
+		} else {
+			game->game_over_timer += delta;
+		}
+	}
+
+
+	game->lifetime += delta;
+
+	output.do_draw = game->do_draw;
+	return output;
+}
+
+
+static bool render_push_square(MvkData* mvk, MvkFrame* frame, int32* vbuffer_i, int32* ibuffer_i, float square_x, float square_y, float square_l, gbVec3 color) {
+	//returns 0 without writing anything once the frame's buffers are full
+	if(*vbuffer_i + 4*sizeof(Vertex) > mvk->vertex_buffer_size || *ibuffer_i + 6*sizeof(int32) > mvk->index_buffer_size) return 0;
+	Vertex square[4] = {
+		{{square_x, square_y}, color},
+		{{square_x + square_l, square_y}, color},
+		{{square_x + square_l, square_y + square_l}, color},
+		{{square_x, square_y + square_l}, color}
+	};
+	int32 base_i = *vbuffer_i/sizeof(Vertex);
+	int32 square_is[6] = {
+		base_i, base_i + 1, base_i + 2, base_i + 2, base_i + 3, base_i
+	};
+	memcpy(frame->vertices + *vbuffer_i, square, 4*sizeof(Vertex));
+	*vbuffer_i += 4*sizeof(Vertex);
+	memcpy(frame->indices + *ibuffer_i, square_is, 6*sizeof(int32));
+	*ibuffer_i += 6*sizeof(int32);
+	return 1;
+}
+static void render_wall(Game* game, MvkData* mvk, MvkFrame* frame) {
+	//the boards are copied as they are into the instance buffer, the boards pipeline's vertex shader unpacks their cells
+	Wall* wall = game->wall;
+	int32 boards_size = min(wall->size, cast(int32, mvk->instance_buffer_size/sizeof(Board)));
+	float screen_w = mvk->swap_chain_image_extent.width;
+	float screen_h = mvk->swap_chain_image_extent.height;
+	//as many boards per row as makes them the biggest they can be while all of them fit
+	int32 columns = 1;
+	float board_l = 0;
+	int32 columns_guess = cast(int32, gb_sqrt(boards_size*screen_w/screen_h));
+	for_each_in_range(c, max(columns_guess - 1, 1), max(columns_guess + 1, 1)) {
+		int32 rows = (boards_size + c - 1)/c;
+		float l = min(screen_w/c, screen_h/rows);
+		if(l > board_l) {
+			board_l = l;
+			columns = c;
+		}
+	}
+	float cell_pitch = 0.9f*board_l/BOARD_SIZE;
+	float cell_l = 0.85f*cell_pitch;
+
+	UniformBufferObject ubo;
+	gb_mat4_identity(&ubo.model);
+	ubo.model.x.x = 2.0f/screen_w;
+	ubo.model.y.y = 2.0f/screen_h;
+	ubo.model.w.x = -1.0f;
+	ubo.model.w.y = -1.0f;
+	for_each_lt(i, BOARD_EXPONENT_MAX + 1) {
+		gbVec3 color = game->colors[min(i, game->colors_size - 1)];
+		ubo.colors[i] = gb_vec4(color.r, color.g, color.b, 1.0f);
+	}
+	ubo.boards_layout = gb_vec4(board_l, cell_pitch, cell_l, columns);
+	memcpy(frame->uniform, &ubo, sizeof(UniformBufferObject));
+
+	if(mvk->boards_pipeline != VK_NULL_HANDLE) {
+		memcpy(frame->instances, wall_boards(wall), boards_size*sizeof(Board));
+		frame->instances_size = boards_size;
+		frame->indices_size = 0;
+	} else {
+		//without the boards shader every cell is pushed as a square, only as many boards as fit in the vertex buffer get drawn
+		int32 vbuffer_i = 0;
+		int32 ibuffer_i = 0;
+		float margin = (board_l - BOARD_SIZE*cell_pitch + cell_pitch - cell_l)/2;
+		bool is_full = 0;
+		for_each_lt(i, boards_size) {
+			Board board = wall_boards(wall)[i];
+			float board_x = board_l*(i%columns) + margin;
+			float board_y = board_l*(i/columns) + margin;
+			for_each_lt(cell, BOARD_CELLS) {
+				gbVec4 color = ubo.colors[(board >> (4*cell)) & 0xf];
+				is_full = !render_push_square(mvk, frame, &vbuffer_i, &ibuffer_i, board_x + cell_pitch*(cell%BOARD_SIZE), board_y + cell_pitch*(cell/BOARD_SIZE), cell_l, color.xyz);
+				if(is_full) break;
+			}
+			if(is_full) break;
+		}
+		frame->instances_size = 0;
+		frame->indices_size = ibuffer_i/sizeof(int32);
+	}
+}
+void game_render(Game* game, double delta, MvkData* mvk, int32 frame_i) {
+	//the buffers of this frame are no longer in use by the gpu, so we can write straight into them
+	MvkFrame* frame = &mvk->frames[frame_i];
+	if(game->wall->size > 0) {
+		render_wall(game, mvk, frame);
+		return;
+	}
+	frame->instances_size = 0;
+	byte* vbuffer = frame->vertices;
+	byte* ibuffer = frame->indices;
+	int32 vbuffer_i = 0;
+	int32 ibuffer_i = 0;
+
+
+	{//fill gpu buffers
+		float screen_w = mvk->swap_chain_image_extent.width;
+		float screen_h = mvk->swap_chain_image_extent.height;
+		float pixel_l = min(screen_w, screen_h);
+
+
+		float square_base_l = gb_floor(pixel_l/max(game->grid_w, game->grid_h));
+		float square_gap = min(20.0f, gb_floor(square_base_l/4));
+		float square_l = square_base_l - square_gap;
+		Tweens* tweens = game->tweens;
+		tweens_update(tweens, delta);
+		if(tweens->size > 0) {
+			//empty cells underneath, then every tile wherever its tween has it this frame
+			for_each_lt(y, game->grid_h) {
+				for_each_lt(x, game->grid_w) {
+					if(!render_push_square(mvk, frame, &vbuffer_i, &ibuffer_i, square_base_l*x + square_gap/2, square_base_l*y + square_gap/2, square_l, game->colors[0])) break;
+				}
+			}
+			tweens_evaluate(tweens);
+			float* tile_xs = tweens_field(tweens, TWEEN_X);
+			float* tile_ys = tweens_field(tweens, TWEEN_Y);
+			float* tile_scales = tweens_field(tweens, TWEEN_SCALE);
+			int32* tile_values = tweens_values(tweens);
+			for_each_lt(i, tweens->size) {
+				if(tile_scales[i] <= 0) continue;
+				float l = square_l*tile_scales[i];
+				float square_x = square_base_l*(tile_xs[i] + .5f) - l/2;
+				float square_y = square_base_l*(tile_ys[i] + .5f) - l/2;
+				gbVec3 color = game->colors[min(game->colors_size - 1, tile_values[i])];
+				if(!render_push_square(mvk, frame, &vbuffer_i, &ibuffer_i, square_x, square_y, l, color)) break;
+			}
+		} else {
+			for_each_lt(y, game->grid_h) {
+				for_each_lt(x, game->grid_w) {
+					int32 v = game->grid[x + game->grid_w*y];
+					float square_x = square_base_l*x + square_gap/2;
+					float square_y = square_base_l*y + square_gap/2;
+					gbVec3 color = game->colors[min(game->colors_size - 1, v)];
+					if(!render_push_square(mvk, frame, &vbuffer_i, &ibuffer_i, square_x, square_y, square_l, color)) break;
+				}
+			}
+		}
+		if(game->hint_move != MOVE_NONE && game->state == GAME_STATE_2048 && vbuffer_i + 4*sizeof(Vertex) <= mvk->vertex_buffer_size && ibuffer_i + 6*sizeof(int32) <= mvk->index_buffer_size) {
+			//the hint is a bar in the margin along the edge the solver wants to move towards
+			float bar_l = max(square_gap/2, 2.0f);
+			float bar_x = 0;
+			float bar_y = 0;
+			float bar_w = square_base_l*game->grid_w;
+			float bar_h = square_base_l*game->grid_h;
+			if(game->hint_move == MOVE_LEFT) {
+				bar_w = bar_l;
+			} else if(game->hint_move == MOVE_RIGHT) {
+				bar_x = bar_w - bar_l;
+				bar_w = bar_l;
+			} else if(game->hint_move == MOVE_UP) {
+				bar_h = bar_l;
+			} else if(game->hint_move == MOVE_DOWN) {
+				bar_y = bar_h - bar_l;
+				bar_h = bar_l;
+			}
+			gbVec3 color = game->colors[game->colors_size - 1];
+			Vertex bar[4] = {
+				{{bar_x, bar_y}, color},
+				{{bar_x + bar_w, bar_y}, color},
+				{{bar_x + bar_w, bar_y + bar_h}, color},
+				{{bar_x, bar_y + bar_h}, color}
+			};
+			int32 base_i = vbuffer_i/sizeof(Vertex);
+			int32 bar_is[6] = {
+				base_i, base_i + 1, base_i + 2, base_i + 2, base_i + 3, base_i
+			};
+			memcpy(vbuffer + vbuffer_i, bar, 4*sizeof(Vertex));
+			vbuffer_i += 4*sizeof(Vertex);
+			memcpy(ibuffer + ibuffer_i, bar_is, 6*sizeof(int32));
+			ibuffer_i += 6*sizeof(int32);
+		}
+
+
+		UniformBufferObject ubo;
+		gb_mat4_identity(&ubo.model);
+		if(screen_w >= screen_h) {
+			ubo.model.w.x += (screen_w - screen_h)/2.0f;
+		} else {
+			ubo.model.w.y += (screen_h - screen_w)/2.0f;
+		}
+		ubo.model.x.x *= 2.0f/screen_w;
+		ubo.model.w.x *= 2.0f/screen_w;
+		ubo.model.y.y *= 2.0f/screen_h;
+		ubo.model.w.y *= 2.0f/screen_h;
+		ubo.model.w.x += -1.0f;
+		ubo.model.w.y += -1.0f;
+
+		memcpy(frame->uniform, &ubo, sizeof(UniformBufferObject));
+	}
+	frame->indices_size = ibuffer_i/sizeof(int32);
+}
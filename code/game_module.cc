@@ -0,0 +1,54 @@
+// The game module, game.hh built on its own as a shared library so that a
+// running game can pick up changes to it without restarting, see module.hh.
+// It is built with the same headers and flags as main.cc, and gets linked
+// against SDL but never against Vulkan, game.hh doesn't call it. Build it
+// with -fvisibility=hidden, so that game_module_load is all it exports and
+// its calls never bind to the executable's copies of the game code.
+#ifdef DEBUG
+#define MAMLIB_DEBUG
+#endif
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+#include "SDL.h"
+#include "vulkan/vulkan.h"
+#undef main
+
+#include "vstack.hh"
+#include "huge.hh"
+#include "board.hh"
+#include "grid.hh"
+#include "tween.hh"
+#include "history.hh"
+#include "wall.hh"
+#include "types.hh"
+#include "config.hh"
+#include "save.hh"
+#include "tablebase.hh"
+
+#define min gb_min
+#define max gb_max
+
+#include "game.hh"
+
+#ifdef _WIN32
+	#define GAME_MODULE_EXPORT extern "C" __declspec(dllexport)
+#else
+	#define GAME_MODULE_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+GAME_MODULE_EXPORT void game_module_load(GameModuleApi* api, MamTrapFunc* trap, void* trap_data) {
+	//the module's statics start out empty every time it is loaded, so everything game.hh expects to be set up is done here
+	mam_set_error_trap(trap, trap_data);
+	board_init_tables();
+	grid_init();
+	api->game_size = sizeof(Game);
+	api->output_size = sizeof(Output);
+	api->mvk_size = sizeof(MvkData);
+	api->update = game_update;
+	api->render = game_render;
+}
@@ -0,0 +1,427 @@
+// Move kernels for grids of any size, used when the board doesn't fit in a
+// bitboard. A grid is grid_w*grid_h int32 exponents in row major order, 0 is
+// empty. Every move is reduced to sliding contiguous lines towards index 0:
+// right moves reverse rows in place, up and down moves slide the rows of a
+// cache blocked transpose. The line kernel is picked once by grid_init from
+// what the cpu supports, SSE4.1 and AVX2 left pack each vector of cells with
+// a shuffle looked up by the mask of its non empty lanes.
+//
+// Every grid has a GridEmpty bitmask of its empty cells next to it, which
+// the kernels keep up to date from how many cells each line kept, so spawning
+// and the game over check never have to scan the grid for empty cells.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRID_X86
+#include <immintrin.h>
+#endif
+
+const int GRID_TRANSPOSE_BLOCK = 32;//in cells, a 32x32 block of each side fits in L1 together
+
+typedef int32 GridSlideFunc(int32* line, int32 size, bool* ret_moved);// returns how many cells are left in the line, ors whether any cell moved into ret_moved
+
+typedef struct GridEmpty {
+	//header of an allocation of grid_empty_alloc_size bytes, it is followed by h rows of row_words bitmask words, h per row counts and w per column counts
+	int32 w;
+	int32 h;
+	int32 row_words;
+	int32 total;
+} GridEmpty;
+
+static GridSlideFunc* grid_slide_line = 0;
+static const char* grid_slide_line_name = "";
+#ifdef GRID_X86
+static uint8 grid__pack_shuffle_sse[16][16];//byte shuffles that move the lanes set in the index to the front
+static int32 grid__pack_permute_avx[256][8];//lane permutations that move the lanes set in the index to the front
+#endif
+
+
+static int32 grid__merge_from(int32* line, int32 size, int32 i) {
+	//merges the equal neighbours of a compacted line, starting from its first equal pair at i, each cell merges at most once
+	int32 w = i;
+	while(i < size) {
+		if(i + 1 < size && line[i] == line[i + 1]) {
+			line[w] = line[i] + 1;
+			i += 2;
+		} else {
+			line[w] = line[i];
+			i += 1;
+		}
+		w += 1;
+	}
+	return w;
+}
+
+static int32 grid__slide_line_scalar(int32* line, int32 size, bool* ret_moved) {
+	bool moved = 0;
+	int32 n = 0;
+	for_each_lt(i, size) {
+		int32 v = line[i];
+		if(v) {
+			if(n != i) {
+				line[n] = v;
+				moved = 1;
+			}
+			n += 1;
+		}
+	}
+	int32 j = 0;
+	for(; j + 1 < n; j += 1) {
+		if(line[j] == line[j + 1]) break;
+	}
+	if(j + 1 < n) {
+		n = grid__merge_from(line, n, j);
+		moved = 1;
+	}
+	memzero(line + n, size - n);
+	*ret_moved |= moved;
+	return n;
+}
+
+#ifdef GRID_X86
+__attribute__((target("sse4.1")))
+static int32 grid__slide_line_sse41(int32* line, int32 size, bool* ret_moved) {
+	//NOTE: compaction happens in place, a store at n only ever overwrites lanes that were already loaded since n <= i
+	bool moved = 0;
+	int32 n = 0;
+	int32 i = 0;
+	__m128i zero = _mm_setzero_si128();
+	for(; i + 4 <= size; i += 4) {
+		__m128i v = _mm_loadu_si128((__m128i*)(line + i));
+		uint32 mask = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, zero))) & 0xf;
+		if(!mask) continue;
+		//a mask that isn't a run of low bits has a gap to close
+		moved |= (n != i) | ((mask & (mask + 1)) != 0);
+		__m128i packed = _mm_shuffle_epi8(v, _mm_loadu_si128((__m128i*)grid__pack_shuffle_sse[mask]));
+		_mm_storeu_si128((__m128i*)(line + n), packed);
+		n += __builtin_popcount(mask);
+	}
+	for(; i < size; i += 1) {
+		int32 v = line[i];
+		if(v) {
+			moved |= (n != i);
+			line[n] = v;
+			n += 1;
+		}
+	}
+	int32 j = 0;
+	for(; j + 4 < n; j += 4) {
+		__m128i a = _mm_loadu_si128((__m128i*)(line + j));
+		__m128i b = _mm_loadu_si128((__m128i*)(line + j + 1));
+		if(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)))) break;
+	}
+	for(; j + 1 < n; j += 1) {
+		if(line[j] == line[j + 1]) break;
+	}
+	if(j + 1 < n) {
+		n = grid__merge_from(line, n, j);
+		moved = 1;
+	}
+	memzero(line + n, size - n);
+	*ret_moved |= moved;
+	return n;
+}
+
+__attribute__((target("avx2")))
+static int32 grid__slide_line_avx2(int32* line, int32 size, bool* ret_moved) {
+	bool moved = 0;
+	int32 n = 0;
+	int32 i = 0;
+	__m256i zero = _mm256_setzero_si256();
+	for(; i + 8 <= size; i += 8) {
+		__m256i v = _mm256_loadu_si256((__m256i*)(line + i));
+		uint32 mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero))) & 0xff;
+		if(!mask) continue;
+		moved |= (n != i) | ((mask & (mask + 1)) != 0);
+		__m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_loadu_si256((__m256i*)grid__pack_permute_avx[mask]));
+		_mm256_storeu_si256((__m256i*)(line + n), packed);
+		n += __builtin_popcount(mask);
+	}
+	for(; i < size; i += 1) {
+		int32 v = line[i];
+		if(v) {
+			moved |= (n != i);
+			line[n] = v;
+			n += 1;
+		}
+	}
+	int32 j = 0;
+	for(; j + 8 < n; j += 8) {
+		__m256i a = _mm256_loadu_si256((__m256i*)(line + j));
+		__m256i b = _mm256_loadu_si256((__m256i*)(line + j + 1));
+		if(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))) break;
+	}
+	for(; j + 1 < n; j += 1) {
+		if(line[j] == line[j + 1]) break;
+	}
+	if(j + 1 < n) {
+		n = grid__merge_from(line, n, j);
+		moved = 1;
+	}
+	memzero(line + n, size - n);
+	*ret_moved |= moved;
+	return n;
+}
+#endif
+
+void grid_init() {
+	//NOTE: not thread safe, call once at startup before any other grid function
+	if(grid_slide_line) return;
+	grid_slide_line = grid__slide_line_scalar;
+	grid_slide_line_name = "scalar";
+	#ifdef GRID_X86
+	for_each_lt(mask, 256) {
+		int32 n = 0;
+		for_each_lt(lane, 8) {
+			if(mask & (1 << lane)) {
+				grid__pack_permute_avx[mask][n] = lane;
+				if(mask < 16) {
+					for_each_lt(b, 4) grid__pack_shuffle_sse[mask][4*n + b] = 4*lane + b;
+				}
+				n += 1;
+			}
+		}
+		//the lanes past the packed ones are garbage that gets overwritten or zeroed, they only need to be valid indices
+		for(int32 k = n; k < 8; k += 1) {
+			grid__pack_permute_avx[mask][k] = 0;
+			if(mask < 16 && k < 4) {
+				for_each_lt(b, 4) grid__pack_shuffle_sse[mask][4*k + b] = b;
+			}
+		}
+	}
+	if(SDL_HasAVX2()) {
+		grid_slide_line = grid__slide_line_avx2;
+		grid_slide_line_name = "avx2";
+	} else if(SDL_HasSSE41()) {
+		grid_slide_line = grid__slide_line_sse41;
+		grid_slide_line_name = "sse4.1";
+	}
+	#endif
+}
+
+
+static void grid__reverse_line(int32* line, int32 size) {
+	for(int32 i = 0, j = size - 1; i < j; (i += 1, j -= 1)) {
+		int32 v = line[i];
+		line[i] = line[j];
+		line[j] = v;
+	}
+}
+
+void grid_transpose(int32* dst, int32* src, int32 w, int32 h) {
+	//src is w wide and h tall, dst ends up h wide and w tall
+	for(int32 by = 0; by < h; by += GRID_TRANSPOSE_BLOCK) {
+		int32 ey = (by + GRID_TRANSPOSE_BLOCK < h) ? by + GRID_TRANSPOSE_BLOCK : h;
+		for(int32 bx = 0; bx < w; bx += GRID_TRANSPOSE_BLOCK) {
+			int32 ex = (bx + GRID_TRANSPOSE_BLOCK < w) ? bx + GRID_TRANSPOSE_BLOCK : w;
+			for(int32 y = by; y < ey; y += 4) {
+				for(int32 x = bx; x < ex; x += 4) {
+					#ifdef GRID_X86
+					if(y + 4 <= ey && x + 4 <= ex) {
+						//SSE2 is part of x86-64, so the 4x4 micro kernel needs no dispatch
+						__m128i r0 = _mm_loadu_si128((__m128i*)(src + x + w*y));
+						__m128i r1 = _mm_loadu_si128((__m128i*)(src + x + w*(y + 1)));
+						__m128i r2 = _mm_loadu_si128((__m128i*)(src + x + w*(y + 2)));
+						__m128i r3 = _mm_loadu_si128((__m128i*)(src + x + w*(y + 3)));
+						__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+						__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+						__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+						__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+						_mm_storeu_si128((__m128i*)(dst + y + h*x), _mm_unpacklo_epi64(t0, t1));
+						_mm_storeu_si128((__m128i*)(dst + y + h*(x + 1)), _mm_unpackhi_epi64(t0, t1));
+						_mm_storeu_si128((__m128i*)(dst + y + h*(x + 2)), _mm_unpacklo_epi64(t2, t3));
+						_mm_storeu_si128((__m128i*)(dst + y + h*(x + 3)), _mm_unpackhi_epi64(t2, t3));
+						continue;
+					}
+					#endif
+					for(int32 yy = y; yy < y + 4 && yy < ey; yy += 1) {
+						for(int32 xx = x; xx < x + 4 && xx < ex; xx += 1) {
+							dst[yy + h*xx] = src[xx + w*yy];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static inline uint64* grid__empty_row(GridEmpty* empty, int32 y) {
+	return ptr_add(uint64, empty, sizeof(GridEmpty)) + cast(inta, empty->row_words)*y;
+}
+static inline int32* grid__empty_row_counts(GridEmpty* empty) {
+	return cast(int32*, grid__empty_row(empty, empty->h));
+}
+static inline int32* grid__empty_col_counts(GridEmpty* empty) {
+	return grid__empty_row_counts(empty) + empty->h;
+}
+static inline uint64 grid__bit_range(int32 a, int32 b) {
+	//bits [a, b) of a word, 0 <= a <= b <= 64
+	uint64 below_b = (b >= 64) ? ~cast(uint64, 0) : (cast(uint64, 1) << b) - 1;
+	uint64 below_a = (a >= 64) ? ~cast(uint64, 0) : (cast(uint64, 1) << a) - 1;
+	return below_b & ~below_a;
+}
+static void grid__empty_fill_row(GridEmpty* empty, int32 y, int32 x0, int32 x1) {
+	//marks cells [x0, x1) of row y empty and the rest of the row full
+	uint64* row = grid__empty_row(empty, y);
+	for_each_lt(k, empty->row_words) {
+		int32 lo = 64*k;
+		int32 a = x0 - lo;
+		int32 b = x1 - lo;
+		a = (a < 0) ? 0 : (a > 64) ? 64 : a;
+		b = (b < 0) ? 0 : (b > 64) ? 64 : b;
+		row[k] = grid__bit_range(a, b);
+	}
+	int32* row_counts = grid__empty_row_counts(empty);
+	empty->total += (x1 - x0) - row_counts[y];
+	row_counts[y] = x1 - x0;
+}
+static void grid__transpose_bits(uint64* block) {
+	//transposes a 64x64 bit matrix in place, bit x of word y ends up as bit y of word x
+	//swaps ever smaller off diagonal sub blocks, 32x32 first, then the 16x16 ones inside each of those, and so on
+	uint64 mask = 0x00000000ffffffffull;
+	for(int32 j = 32; j != 0; (j >>= 1, mask ^= mask << j)) {
+		for(int32 k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			uint64 t = ((block[k] >> j) ^ block[k | j]) & mask;
+			block[k] ^= t << j;
+			block[k | j] ^= t;
+		}
+	}
+}
+static void grid__empty_fill_cols(GridEmpty* empty, bool from_top) {
+	//rebuilds every row from the column counts, column x keeps its cells in its first col_counts[x] rows, or its last when !from_top
+	//a column's empty cells are one range of rows, so 64 rows of a column are one bit range, and each 64x64 block of cells is built as 64 column words and bit transposed into its 64 row words
+	int32* row_counts = grid__empty_row_counts(empty);
+	int32* col_counts = grid__empty_col_counts(empty);
+	int32 w = empty->w;
+	int32 h = empty->h;
+	memzero(row_counts, h);
+	uint64 block[64];
+	for(int32 by = 0; by < h; by += 64) {
+		int32 rows = (h - by < 64) ? h - by : 64;
+		for_each_lt(k, empty->row_words) {
+			int32 lo = 64*k;
+			int32 size = (w - lo < 64) ? w - lo : 64;
+			for_each_lt(b, size) {
+				int32 filled = col_counts[lo + b];
+				int32 a = (from_top ? filled : 0) - by;
+				int32 e = (from_top ? h : h - filled) - by;
+				a = (a < 0) ? 0 : (a > 64) ? 64 : a;
+				e = (e < 0) ? 0 : (e > 64) ? 64 : e;
+				block[b] = grid__bit_range(a, e);
+			}
+			for(int32 b = size; b < 64; b += 1) block[b] = 0;
+			grid__transpose_bits(block);
+			for_each_lt(r, rows) {
+				grid__empty_row(empty, by + r)[k] = block[r];
+				row_counts[by + r] += __builtin_popcountll(block[r]);
+			}
+		}
+	}
+	empty->total = 0;
+	for_each_lt(y, h) empty->total += row_counts[y];
+}
+
+inta grid_empty_alloc_size(int32 w, int32 h) {
+	int32 row_words = (w + 63)/64;
+	return sizeof(GridEmpty) + sizeof(uint64)*cast(inta, row_words)*h + sizeof(int32)*(h + w);
+}
+void grid_empty_build(GridEmpty* empty, int32* grid, int32 w, int32 h) {
+	//scans the grid once, after this grid_move and grid_spawn keep the bitmask up to date themselves
+	empty->w = w;
+	empty->h = h;
+	empty->row_words = (w + 63)/64;
+	empty->total = 0;
+	int32* row_counts = grid__empty_row_counts(empty);
+	for_each_lt(y, h) {
+		uint64* row = grid__empty_row(empty, y);
+		int32 row_total = 0;
+		for_each_lt(k, empty->row_words) {
+			int32 lo = 64*k;
+			int32 size = (w - lo < 64) ? w - lo : 64;
+			uint64 word = 0;
+			for_each_lt(b, size) word |= cast(uint64, grid[lo + b + w*y] == 0) << b;
+			row[k] = word;
+			row_total += __builtin_popcountll(word);
+		}
+		row_counts[y] = row_total;
+		empty->total += row_total;
+	}
+}
+
+bool grid_move(int32* grid, int32* scratch, GridEmpty* empty, int32 w, int32 h, int32 move) {
+	//scratch must hold w*h cells, it is only used by up and down moves
+	bool moved = 0;
+	if(move == MOVE_LEFT || move == MOVE_RIGHT) {
+		for_each_lt(y, h) {
+			int32* line = grid + w*y;
+			if(move == MOVE_RIGHT) grid__reverse_line(line, w);
+			int32 n = grid_slide_line(line, w, &moved);
+			if(move == MOVE_RIGHT) {
+				grid__reverse_line(line, w);
+				grid__empty_fill_row(empty, y, 0, w - n);
+			} else {
+				grid__empty_fill_row(empty, y, n, w);
+			}
+		}
+	} else if(move == MOVE_UP || move == MOVE_DOWN) {
+		int32* col_counts = grid__empty_col_counts(empty);
+		grid_transpose(scratch, grid, w, h);
+		for_each_lt(x, w) {
+			int32* line = scratch + h*x;
+			if(move == MOVE_DOWN) grid__reverse_line(line, h);
+			col_counts[x] = grid_slide_line(line, h, &moved);
+			if(move == MOVE_DOWN) grid__reverse_line(line, h);
+		}
+		if(moved) {
+			grid_transpose(grid, scratch, h, w);
+			grid__empty_fill_cols(empty, move == MOVE_UP);
+		}
+	}
+	return moved;
+}
+
+int32 grid_spawn(int32* grid, GridEmpty* empty, PCG* rng) {
+	//same rules as board_spawn, a uniformly chosen empty cell in row major order gets a 2 or a 4
+	//returns the index of the cell, -1 when the grid is full
+	if(empty->total == 0) return -1;
+	int32 n = pcg_random_in(rng, 0, empty->total - 1);
+	int32 v = pcg_random_in(rng, 1, 2);
+	//walk the row counts, then the row's words, then select the bit within the word
+	int32* row_counts = grid__empty_row_counts(empty);
+	int32 y = 0;
+	while(n >= row_counts[y]) {
+		n -= row_counts[y];
+		y += 1;
+	}
+	uint64* row = grid__empty_row(empty, y);
+	int32 k = 0;
+	while(1) {
+		int32 word_size = __builtin_popcountll(row[k]);
+		if(n < word_size) break;
+		n -= word_size;
+		k += 1;
+	}
+	int32 b = board_select_bit(row[k], n);
+	int32 cell = 64*k + b + empty->w*y;
+	grid[cell] = v;
+	row[k] &= ~(cast(uint64, 1) << b);
+	row_counts[y] -= 1;
+	empty->total -= 1;
+	return cell;
+}
+bool grid_is_game_over(int32* grid, GridEmpty* empty) {
+	if(empty->total > 0) return 0;
+	//a full grid can still move if two neighbours are equal, rows are compared whole against their shifted self and the row below
+	int32 w = empty->w;
+	int32 h = empty->h;
+	for_each_lt(y, h) {
+		int32* row = grid + w*y;
+		int32 has_pair = 0;
+		for_each_lt(x, w - 1) has_pair |= (row[x] == row[x + 1]);
+		if(y + 1 < h) {
+			int32* below = row + w;
+			for_each_lt(x, w) has_pair |= (row[x] == below[x]);
+		}
+		if(has_pair) return 0;
+	}
+	return 1;
+}
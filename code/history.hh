@@ -0,0 +1,88 @@
+// Move log of a bitboard game, for undo, redo and jumping to any past move.
+// Each move is one byte: the direction, the spawned tile and the cell it
+// spawned in, which is everything needed to redo it. The board is also kept
+// every HISTORY_KEYFRAME_INTERVAL moves, so any move is reached by replaying
+// at most that many moves from the keyframe before it. The log lives right
+// after the History header in the same allocation, grow it with history_copy.
+
+const int HISTORY_KEYFRAME_INTERVAL = 64;
+
+typedef struct History {
+	//header of an allocation of history_alloc_size bytes, capacity move bytes follow it and then the keyframe Boards
+	int32 capacity;// in moves, always a multiple of HISTORY_KEYFRAME_INTERVAL
+	int32 size;// moves logged, moves past at are the ones that can be redone
+	int32 at;// how many moves into the log the current board is
+	int32 pad;
+} History;
+
+
+static inline uint8* history__moves(History* history) {
+	return ptr_add(uint8, history, sizeof(History));
+}
+static inline Board* history__keyframes(History* history) {
+	return ptr_add(Board, history, sizeof(History) + history->capacity);
+}
+static inline uint8 history__encode(int32 move, int32 cell, int32 tile) {
+	return (move - MOVE_UP) | ((tile - 1) << 2) | (cell << 3);
+}
+static Board history__apply(Board board, uint8 entry) {
+	Board moved = board_move(board, MOVE_UP + (entry & 3));
+	return moved | (cast(Board, ((entry >> 2) & 1) + 1) << (4*(entry >> 3)));
+}
+
+inta history_alloc_size(int32 capacity) {
+	capacity = (capacity + HISTORY_KEYFRAME_INTERVAL - 1)/HISTORY_KEYFRAME_INTERVAL*HISTORY_KEYFRAME_INTERVAL;
+	return sizeof(History) + capacity + sizeof(Board)*(capacity/HISTORY_KEYFRAME_INTERVAL + 1);
+}
+void history_init(History* history, int32 capacity, Board start) {
+	history->capacity = (capacity + HISTORY_KEYFRAME_INTERVAL - 1)/HISTORY_KEYFRAME_INTERVAL*HISTORY_KEYFRAME_INTERVAL;
+	history->size = 0;
+	history->at = 0;
+	history->pad = 0;
+	history__keyframes(history)[0] = start;
+}
+void history_copy(History* dst, History* src) {
+	//dst must have been initialized with at least src's capacity, it gets all of src's moves and keyframes
+	int32 capacity = dst->capacity;
+	memcopy(dst, src, 1);
+	dst->capacity = capacity;
+	memcopy(history__moves(dst), history__moves(src), src->size);
+	memcopy(history__keyframes(dst), history__keyframes(src), src->size/HISTORY_KEYFRAME_INTERVAL + 1);
+}
+
+bool history_push(History* history, int32 move, Board moved, Board spawned) {
+	//logs a move at the current position, dropping any moves that could have been redone
+	//moved is the board right after the move and spawned is the same board after its spawn
+	//returns 0 without logging anything when the log is full
+	if(history->at >= history->capacity) return 0;
+	int32 cell = __builtin_ctzll(moved ^ spawned)/4;
+	int32 tile = cast(int32, (spawned >> (4*cell)) & 0xf);
+	history__moves(history)[history->at] = history__encode(move, cell, tile);
+	history->at += 1;
+	history->size = history->at;
+	if(history->at%HISTORY_KEYFRAME_INTERVAL == 0) {
+		history__keyframes(history)[history->at/HISTORY_KEYFRAME_INTERVAL] = spawned;
+	}
+	return 1;
+}
+
+Board history_board_at(History* history, int32 n) {
+	//the board after the first n moves of the log, n is clamped to what was logged
+	n = (n < 0) ? 0 : (n > history->size) ? history->size : n;
+	int32 keyframe_i = n/HISTORY_KEYFRAME_INTERVAL;
+	Board board = history__keyframes(history)[keyframe_i];
+	uint8* moves = history__moves(history);
+	for_each_in_range(i, keyframe_i*HISTORY_KEYFRAME_INTERVAL, n - 1) board = history__apply(board, moves[i]);
+	return board;
+}
+Board history_jump(History* history, int32 n) {
+	n = (n < 0) ? 0 : (n > history->size) ? history->size : n;
+	history->at = n;
+	return history_board_at(history, n);
+}
+bool history_can_undo(History* history) {
+	return history->at > 0;
+}
+bool history_can_redo(History* history) {
+	return history->at < history->size;
+}
@@ -0,0 +1,84 @@
+// Memory on huge pages, for tables that are read all over at random, where
+// every lookup with small pages is also a likely TLB miss. huge_alloc first
+// asks the system for explicit huge pages, which only works where some have
+// been set aside for it (vm.nr_hugepages on Linux, the lock pages privilege
+// on Windows). Failing that, on Linux it maps the memory aligned to a huge
+// page and advises the kernel to back it with transparent huge pages, and
+// failing that too it is plain small pages. Whichever it got comes back as a
+// HugeBacking, so callers can report it. Transparent only means the kernel
+// took the advice, how much of the memory it really backs with huge pages is
+// up to its settings and how fragmented memory is. The memory always comes
+// back zeroed, and always has to be given back with huge_free.
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+const inta HUGE_PAGE_SIZE = 2*MEGABYTE;
+
+typedef enum HugeBacking {
+	HUGE_BACKING_SMALL,
+	HUGE_BACKING_TRANSPARENT,
+	HUGE_BACKING_EXPLICIT,
+} HugeBacking;
+
+
+static const char* huge_backing_name(int32 backing) {
+	if(backing == HUGE_BACKING_EXPLICIT) return "explicit huge pages";
+	if(backing == HUGE_BACKING_TRANSPARENT) return "transparent huge pages";
+	return "small pages";
+}
+
+static inline inta huge__round(inta size) {
+	return (size + HUGE_PAGE_SIZE - 1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+}
+
+void* huge_alloc(inta size, int32* ret_backing) {
+	size = huge__round(size);
+	void* mem = 0;
+	int32 backing = HUGE_BACKING_SMALL;
+	#ifdef _WIN32
+	inta large_page_size = GetLargePageMinimum();
+	if(large_page_size && size%large_page_size == 0) {
+		mem = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if(mem) backing = HUGE_BACKING_EXPLICIT;
+	}
+	if(!mem) mem = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	#else
+	#ifdef MAP_HUGETLB
+	mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if(mem == MAP_FAILED) {
+		mem = 0;
+	} else {
+		backing = HUGE_BACKING_EXPLICIT;
+	}
+	#endif
+	if(!mem) {
+		//mapped a huge page too big and trimmed down to a huge page boundary, transparent huge pages only back aligned ranges
+		byte* base = cast(byte*, mmap(0, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if(base != MAP_FAILED) {
+			byte* aligned = cast(byte*, (cast(uintptr_t, base) + HUGE_PAGE_SIZE - 1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE);
+			if(aligned > base) munmap(base, aligned - base);
+			byte* end = base + size + HUGE_PAGE_SIZE;
+			if(end > aligned + size) munmap(aligned + size, end - (aligned + size));
+			mem = aligned;
+			#ifdef MADV_HUGEPAGE
+			if(madvise(mem, size, MADV_HUGEPAGE) == 0) backing = HUGE_BACKING_TRANSPARENT;
+			#endif
+		}
+	}
+	#endif
+	if(!mem) {
+		MAM_ERRORL("Could not allocate memory for huge pages");
+	}
+	if(ret_backing) *ret_backing = backing;
+	return mem;
+}
+void huge_free(void* mem, inta size) {
+	//size is the same one mem was allocated with
+	#ifdef _WIN32
+	VirtualFree(mem, 0, MEM_RELEASE);
+	#else
+	munmap(mem, huge__round(size));
+	#endif
+}
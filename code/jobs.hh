@@ -0,0 +1,115 @@
+// A fixed pool of worker threads for running parallel for loops. jobs_run
+// hands every worker the same function and a shared task counter, the calling
+// thread works alongside them, and it returns once every task has finished.
+// Workers are numbered from 1, the calling thread is always worker 0, so per
+// worker state should be sized with jobs_workers_total. jobs_cpu_count and
+// jobs_time are what the command line tools size their pools by and time
+// their runs with.
+
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+const int JOB_WORKERS_MAX = 64;
+
+typedef void JobFunc(void* data, int32 task_i, int32 worker_i);
+
+struct JobPool;
+typedef struct JobWorker {
+	JobPool* pool;
+	int32 worker_i;
+	thread_ptr_t thread;
+	thread_signal_t start;
+} JobWorker;
+
+typedef struct JobPool {
+	int32 workers_size;// threads owned by the pool, not counting the caller of jobs_run
+	JobWorker workers[JOB_WORKERS_MAX];
+	thread_signal_t finished;
+	thread_atomic_int_t workers_busy;
+	thread_atomic_int_t tasks_next;
+	thread_atomic_int_t quit;
+	JobFunc* func;
+	void* data;
+	int32 tasks_total;
+} JobPool;
+
+
+static void jobs__work(JobPool* pool, int32 worker_i) {
+	while(1) {
+		int32 task_i = thread_atomic_int_inc(&pool->tasks_next);
+		if(task_i >= pool->tasks_total) break;
+		pool->func(pool->data, task_i, worker_i);
+	}
+}
+static int jobs__worker_proc(void* user_data) {
+	JobWorker* worker = (JobWorker*)user_data;
+	JobPool* pool = worker->pool;
+	while(1) {
+		thread_signal_wait(&worker->start, THREAD_SIGNAL_WAIT_INFINITE);
+		if(thread_atomic_int_load(&pool->quit)) break;
+		jobs__work(pool, worker->worker_i);
+		if(thread_atomic_int_dec(&pool->workers_busy) == 1) {
+			thread_signal_raise(&pool->finished);
+		}
+	}
+	return 0;
+}
+
+void jobs_init(JobPool* pool, int32 workers_size) {
+	memzero(pool, 1);
+	pool->workers_size = gb_clamp(workers_size, 0, JOB_WORKERS_MAX - 1);
+	thread_signal_init(&pool->finished);
+	for_each_index(JobWorker, i, worker, pool->workers, pool->workers_size) {
+		worker->pool = pool;
+		worker->worker_i = i + 1;
+		thread_signal_init(&worker->start);
+		worker->thread = thread_create(jobs__worker_proc, worker, "job worker", THREAD_STACK_SIZE_DEFAULT);
+	}
+}
+void jobs_term(JobPool* pool) {
+	thread_atomic_int_store(&pool->quit, 1);
+	for_each_in(JobWorker, worker, pool->workers, pool->workers_size) {
+		thread_signal_raise(&worker->start);
+		thread_join(worker->thread);
+		thread_destroy(worker->thread);
+		thread_signal_term(&worker->start);
+	}
+	thread_signal_term(&pool->finished);
+	pool->workers_size = 0;
+}
+int32 jobs_workers_total(JobPool* pool) {
+	return pool->workers_size + 1;
+}
+
+int32 jobs_cpu_count() {
+	#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+	#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+	#endif
+}
+double jobs_time() {
+	//seconds on a monotonic clock
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1000000000.0;
+}
+
+void jobs_run(JobPool* pool, JobFunc* func, void* data, int32 tasks_total) {
+	//NOTE: not reentrant, only one thread may be inside jobs_run at a time and func must not call it
+	if(tasks_total <= 0) return;
+	pool->func = func;
+	pool->data = data;
+	pool->tasks_total = tasks_total;
+	thread_atomic_int_store(&pool->tasks_next, 0);
+	//no point waking more workers than there are tasks for
+	int32 workers_woken = min(pool->workers_size, tasks_total - 1);
+	thread_atomic_int_store(&pool->workers_busy, workers_woken);
+	for_each_lt(i, workers_woken) thread_signal_raise(&pool->workers[i].start);
+	jobs__work(pool, 0);
+	if(workers_woken > 0) thread_signal_wait(&pool->finished, THREAD_SIGNAL_WAIT_INFINITE);
+}
@@ -8,6 +8,8 @@
 #include "mamlib.h"
 #define PCG_IMPLEMENTATION
 #include "pcg.h"
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
 #define GB_MATH_IMPLEMENTATION
 #include "gb_math.h"
 #include "basic.h"
@@ -16,14 +18,30 @@
 #include "vulkan/vulkan.h"
 #undef main
 
+#include "memprof.hh"
+#include "vstack.hh"
+#include "huge.hh"
+#include "board.hh"
+#include "grid.hh"
+#include "tween.hh"
+#include "history.hh"
+#include "wall.hh"
 #include "types.hh"
 #include "config.hh"
+#include "save.hh"
+#include "tablebase.hh"
+#include "ntuple.hh"
 
 #define min gb_min
 #define max gb_max
 
+#include "jobs.hh"
+#include "scratch.hh"
+#include "pool.hh"
+
 
 static MamString read_file_to_stack(const char* filename, MamStack* stack) {
+	//stack has to be a vstack
 	SDL_RWops* file = SDL_RWFromFile(filename, "r");
 	if(!file) {
 		const char* error = SDL_GetError();
@@ -32,21 +50,147 @@ static MamString read_file_to_stack(const char* filename, MamStack* stack) {
 		MAM_ERRORL(str);
 	}
 	int32 size = SDL_RWsize(file);
-	char* buffer = mam_stack_pusht(char, stack, size);
+	char* buffer = vstack_pusht(char, stack, size);
 	SDL_RWread(file, buffer, 1, size);
 	SDL_RWclose(file);
 	return mam_memtostr(buffer, size);
 }
 
 void game_free_recursively(GameMemDesc* desc);
+void solver_cancel(Solver* solver);
+void solver_free(Solver* solver);
+void montecarlo_cancel(MonteCarlo* mc);
+void montecarlo_term(MonteCarlo* mc);
 
 
 static double get_delta_time(uint64 t0, uint64 t1) {
 	return (t1 - t0)/cast(double, SDL_GetPerformanceFrequency());
 }
 
+static double get_display_time_per_frame(int display_index) {
+	SDL_DisplayMode dm;
+	if(SDL_GetDesktopDisplayMode(display_index, &dm) < 0) {
+		printf("SDL_GetDesktopDisplayMode failed: %s\n", SDL_GetError());
+		return DEFAULT_FPS;
+	} else if(dm.refresh_rate <= 0) {//SDL reports 0 when the refresh rate is unspecified
+		return DEFAULT_FPS;
+	}
+	return 1.0/dm.refresh_rate;
+}
+
+static void sort_doubles(double* array, int32 size) {
+	//insertion sort, only ever used on small sample buffers
+	for_each_in_range(i, 1, size - 1) {
+		double v = array[i];
+		int32 j = i - 1;
+		for(; j >= 0 && array[j] > v; j -= 1) array[j + 1] = array[j];
+		array[j + 1] = v;
+	}
+}
+
+void pacing_reset(FramePacing* pacing, int display_index) {
+	pacing->display_index = display_index;
+	pacing->display_time_per_frame = get_display_time_per_frame(display_index);
+	pacing->measured_time_per_frame = 0;
+	pacing->last_present = 0;
+	pacing->last_display_present = 0;
+	pacing->wake_delay = 0;
+	pacing->slack = 0;
+	pacing->present_intervals_size = 0;
+	pacing->present_intervals_i = 0;
+}
+void pacing_record_interval(FramePacing* pacing, double interval) {
+	//NOTE: only call this for frames paced by vsync, otherwise we would be measuring our own frame limiter
+	double expected = pacing->display_time_per_frame;
+	if(interval >= PRESENT_INTERVAL_MIN_RATIO*expected && interval <= PRESENT_INTERVAL_MAX_RATIO*expected) {
+		pacing->present_intervals[pacing->present_intervals_i] = interval;
+		pacing->present_intervals_i = (pacing->present_intervals_i + 1)%PRESENT_INTERVAL_SAMPLES;
+		pacing->present_intervals_size = min(pacing->present_intervals_size + 1, PRESENT_INTERVAL_SAMPLES);
+	}
+	if(pacing->present_intervals_size == PRESENT_INTERVAL_SAMPLES) {
+		//variable refresh displays don't present at the rate of their display mode, so we take the median of recent presents as the real interval
+		double sorted[PRESENT_INTERVAL_SAMPLES];
+		memcopy(sorted, pacing->present_intervals, PRESENT_INTERVAL_SAMPLES);
+		sort_doubles(sorted, PRESENT_INTERVAL_SAMPLES);
+		pacing->measured_time_per_frame = sorted[PRESENT_INTERVAL_SAMPLES/2];
+	}
+}
+double pacing_record_present(FramePacing* pacing, uint64 present_time) {
+	double interval = 0;
+	if(pacing->last_present) {
+		interval = get_delta_time(pacing->last_present, present_time);
+		pacing_record_interval(pacing, interval);
+	}
+	pacing->last_present = present_time;
+	return interval;
+}
+double pacing_time_per_frame(FramePacing* pacing) {
+	return pacing->measured_time_per_frame > 0 ? pacing->measured_time_per_frame : pacing->display_time_per_frame;
+}
+void pacing_update_wake_delay(FramePacing* pacing, double slack, bool missed_vsync) {
+	//we want every vsynced frame to be ready just before its deadline, any earlier and the input it shows is staler than it needs to be
+	if(missed_vsync) {
+		//back off fast, a missed vsync costs a whole frame of latency
+		pacing->wake_delay *= 0.5;
+		pacing->slack = 0;
+	} else {
+		pacing->slack += PRESENT_SLACK_GAIN*(slack - pacing->slack);
+		pacing->wake_delay += PRESENT_SLACK_GAIN*(pacing->slack - PRESENT_SLACK_TARGET);
+	}
+	pacing->wake_delay = max(min(pacing->wake_delay, pacing_time_per_frame(pacing) - PRESENT_SLACK_TARGET), 0.0);
+}
+bool pacing_poll_display_timing(FramePacing* pacing, MvkData* mvk) {
+	//VK_GOOGLE_display_timing tells us exactly when past frames hit the screen and how early they were ready (presentMargin)
+	VkPastPresentationTimingGOOGLE timings[PRESENT_TIMINGS_MAX];
+	uint32 timings_size = PRESENT_TIMINGS_MAX;
+	VkResult result = mvk->get_past_presentation_timing(mvk->device, mvk->swap_chain, &timings_size, timings);
+	if(result != VK_SUCCESS && result != VK_INCOMPLETE) return 0;
+	for_each_in(VkPastPresentationTimingGOOGLE, timing, timings, timings_size) {
+		bool missed_vsync = 0;
+		if(pacing->last_display_present && timing->actualPresentTime > pacing->last_display_present) {
+			double interval = (timing->actualPresentTime - pacing->last_display_present)/1000000000.0;
+			pacing_record_interval(pacing, interval);
+			missed_vsync = interval > PRESENT_MISSED_RATIO*pacing_time_per_frame(pacing);
+		}
+		pacing->last_display_present = timing->actualPresentTime;
+		pacing_update_wake_delay(pacing, timing->presentMargin/1000000000.0, missed_vsync);
+	}
+	return timings_size > 0;
+}
+
+static uint64 wait_until(uint64 target) {
+	uint64 now = SDL_GetPerformanceCounter();
+	if(now >= target) return now;
+	double time_to_wait = get_delta_time(now, target) - DELAY_RESOLUTION;
+	if(time_to_wait > 0) {
+		SDL_Delay(cast(uint32, 1000.0*time_to_wait));
+	}
+	while(now < target) {
+		now = SDL_GetPerformanceCounter();
+	}
+	return now;
+}
+
+void latency_record(LatencyStats* stats, uint32 input_timestamp, uint32 present_timestamp) {
+	stats->samples[stats->samples_i] = present_timestamp - input_timestamp;
+	stats->samples_i = (stats->samples_i + 1)%LATENCY_SAMPLES;
+	stats->samples_size = min(stats->samples_size + 1, LATENCY_SAMPLES);
+}
+void latency_print(LatencyStats* stats) {
+	if(stats->samples_size == 0) return;
+	double sorted[LATENCY_SAMPLES];
+	int32 size = stats->samples_size;
+	memcopy(sorted, stats->samples, size);
+	sort_doubles(sorted, size);
+	printf("input to present latency: p50 %.0fms, p90 %.0fms, p99 %.0fms, max %.0fms (%d samples)\n", sorted[size/2], sorted[(9*size)/10], sorted[(99*size)/100], sorted[size - 1], size);
+}
+
 
 void main_cleanup(MainTrash* data) {
+	//the solver's and monte carlo's threads may be in the middle of a search on the job pool
+	if(data->solver) solver_cancel(data->solver);
+	if(data->montecarlo) montecarlo_cancel(data->montecarlo);
+	if(data->jobs) jobs_term(data->jobs);
 	{//clean up vulkan
 		MvkData* mvk = data->mvk;
 		if(mvk->device) vkDeviceWaitIdle(mvk->device);
@@ -60,18 +204,25 @@ void main_cleanup(MainTrash* data) {
 			for_each_in(VkFramebuffer, frame_buffer, mvk->frame_buffers, mvk->swap_chain_size) vkDestroyFramebuffer(mvk->device, *frame_buffer, 0);
 		}
 		if(mvk->pipeline) vkDestroyPipeline(mvk->device, mvk->pipeline, 0);
+		if(mvk->boards_pipeline) vkDestroyPipeline(mvk->device, mvk->boards_pipeline, 0);
 		if(mvk->pipeline_layout) vkDestroyPipelineLayout(mvk->device, mvk->pipeline_layout, 0);
 		if(mvk->render_pass) vkDestroyRenderPass(mvk->device, mvk->render_pass, 0);
 		for_each_in(VkPipelineShaderStageCreateInfo, shader_stage, mvk->shader_stages, mvk->shader_stages_size) vkDestroyShaderModule(mvk->device, shader_stage->module, 0);
 		for_each_in(VkImageView, image_view, mvk->swap_chain_image_views, mvk->swap_chain_size) vkDestroyImageView(mvk->device, *image_view, 0);
 		if(mvk->swap_chain) vkDestroySwapchainKHR(mvk->device, mvk->swap_chain, 0);
 		if(mvk->descriptor_set_layout) vkDestroyDescriptorSetLayout(mvk->device, mvk->descriptor_set_layout, 0);
-		if(mvk->vertex_buffer) vkDestroyBuffer(mvk->device, mvk->vertex_buffer, 0);
-		if(mvk->vertex_buffer_memory) vkFreeMemory(mvk->device, mvk->vertex_buffer_memory, 0);
-		if(mvk->index_buffer) vkDestroyBuffer(mvk->device, mvk->index_buffer, 0);
-		if(mvk->index_buffer_memory) vkFreeMemory(mvk->device, mvk->index_buffer_memory, 0);
-		if(mvk->uniform_buffer) vkDestroyBuffer(mvk->device, mvk->uniform_buffer, 0);
-		if(mvk->uniform_buffer_memory) vkFreeMemory(mvk->device, mvk->uniform_buffer_memory, 0);
+		if(mvk->frames) {
+			for_each_in(MvkFrame, frame, mvk->frames, MVK_FRAMES_IN_FLIGHT) {
+				if(frame->vertex_buffer) vkDestroyBuffer(mvk->device, frame->vertex_buffer, 0);
+				if(frame->vertex_buffer_memory) vkFreeMemory(mvk->device, frame->vertex_buffer_memory, 0);
+				if(frame->index_buffer) vkDestroyBuffer(mvk->device, frame->index_buffer, 0);
+				if(frame->index_buffer_memory) vkFreeMemory(mvk->device, frame->index_buffer_memory, 0);
+				if(frame->uniform_buffer) vkDestroyBuffer(mvk->device, frame->uniform_buffer, 0);
+				if(frame->uniform_buffer_memory) vkFreeMemory(mvk->device, frame->uniform_buffer_memory, 0);
+				if(frame->instance_buffer) vkDestroyBuffer(mvk->device, frame->instance_buffer, 0);
+				if(frame->instance_buffer_memory) vkFreeMemory(mvk->device, frame->instance_buffer_memory, 0);
+			}
+		}
 		if(mvk->descriptor_pool) vkDestroyDescriptorPool(mvk->device, mvk->descriptor_pool, 0);
 		if(mvk->surface) vkDestroySurfaceKHR(mvk->instance, mvk->surface, 0);
 		if(mvk->device) vkDestroyDevice(mvk->device, 0);
@@ -80,7 +231,14 @@ void main_cleanup(MainTrash* data) {
 	if(data->window) SDL_DestroyWindow(data->window);
 	if(data->sdl_isinit) SDL_Quit();
 	#ifdef DEBUG
+	scratch_term();
+	if(data->mvk->stack) vstack_free(data->mvk->stack);
 	if(data->game_desc.mem) game_free_recursively(&data->game_desc);
+	if(data->solver) solver_free(data->solver);
+	if(data->montecarlo) {
+		montecarlo_term(data->montecarlo);
+		free(data->montecarlo);
+	}
 	for_each_in(void*, ptr, data->ptrs, TRASH_PTRS_SIZE) {
 		if(*ptr) free(*ptr);
 	}
@@ -178,7 +336,7 @@ void copy_buffer(MvkData* mvk, VkBuffer buffer_dst, VkBuffer buffer_src, VkDevic
 }
 
 void find_device_capabilities(MvkData* mvk, SDL_Window* window) {
-	int32 pre_stack_size = mvk->stack->size;
+	ScratchMark mark = scratch_begin();
 	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(mvk->physical_device, mvk->surface, &mvk->capabilities);
 
 	int width;
@@ -201,7 +359,7 @@ void find_device_capabilities(MvkData* mvk, SDL_Window* window) {
 	*/
 	uint32 present_modes_size = 0;
 	vkGetPhysicalDeviceSurfacePresentModesKHR(mvk->physical_device, mvk->surface, &present_modes_size, 0);
-	VkPresentModeKHR* present_modes = mam_stack_pusht(VkPresentModeKHR, mvk->stack, present_modes_size);
+	VkPresentModeKHR* present_modes = scratch_pusht(VkPresentModeKHR, mark, present_modes_size);
 	vkGetPhysicalDeviceSurfacePresentModesKHR(mvk->physical_device, mvk->surface, &present_modes_size, present_modes);
 
 	mvk->present_mode = VK_PRESENT_MODE_FIFO_KHR;//guaranteed to be available
@@ -221,7 +379,7 @@ void find_device_capabilities(MvkData* mvk, SDL_Window* window) {
 
 	uint32 formats_size = 0;
 	vkGetPhysicalDeviceSurfaceFormatsKHR(mvk->physical_device, mvk->surface, &formats_size, 0);
-	VkSurfaceFormatKHR* formats = mam_stack_pusht(VkSurfaceFormatKHR, mvk->stack, formats_size);
+	VkSurfaceFormatKHR* formats = scratch_pusht(VkSurfaceFormatKHR, mark, formats_size);
 	vkGetPhysicalDeviceSurfaceFormatsKHR(mvk->physical_device, mvk->surface, &formats_size, formats);
 
 	mvk->surface_format = formats[0];
@@ -232,7 +390,7 @@ void find_device_capabilities(MvkData* mvk, SDL_Window* window) {
 		}
 	}
 
-	mam_stack_set_size(mvk->stack, pre_stack_size);
+	scratch_end(&mark);
 }
 
 void create_swap_chain(MvkData* mvk) {
@@ -271,10 +429,10 @@ void create_swap_chain(MvkData* mvk) {
 
 
 	vkGetSwapchainImagesKHR(mvk->device, mvk->swap_chain, &mvk->swap_chain_size, 0);
-	VkImage* swap_chain_images = mam_stack_pusht(VkImage, mvk->stack, mvk->swap_chain_size);
+	VkImage* swap_chain_images = vstack_pusht(VkImage, mvk->stack, mvk->swap_chain_size);
 	vkGetSwapchainImagesKHR(mvk->device, mvk->swap_chain, &mvk->swap_chain_size, swap_chain_images);
 
-	mvk->swap_chain_image_views = mam_stack_pusht(VkImageView, mvk->stack, mvk->swap_chain_size);
+	mvk->swap_chain_image_views = vstack_pusht(VkImageView, mvk->stack, mvk->swap_chain_size);
 	for_each_lt(i, mvk->swap_chain_size) {
 		VkImageViewCreateInfo image_view_info = {};
 		image_view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -295,60 +453,6 @@ void create_swap_chain(MvkData* mvk) {
 			MAM_ERRORL("Failed to create an image view to the vulkan swap chain\n");
 		}
 	}
-
-	{//create uniform buffer
-		VkDeviceSize buffer_size = mvk->swap_chain_size*sizeof(UniformBufferObject);
-
-		create_buffer(mvk, buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &mvk->uniform_buffer, &mvk->uniform_buffer_memory);
-
-		VkDescriptorPoolSize pool_size_info = {};
-		pool_size_info.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		pool_size_info.descriptorCount = mvk->swap_chain_size;
-
-		VkDescriptorPoolCreateInfo pool_info = {};
-		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		pool_info.poolSizeCount = 1;
-		pool_info.pPoolSizes = &pool_size_info;
-		pool_info.maxSets = mvk->swap_chain_size;
-
-		if(vkCreateDescriptorPool(mvk->device, &pool_info, 0, &mvk->descriptor_pool) != VK_SUCCESS) {
-			ERRORL("Failed to create a vulkan descriptor pool\n");
-		}
-
-		VkDescriptorSetLayout* layouts = mam_stack_pusht(VkDescriptorSetLayout, mvk->stack, mvk->swap_chain_size);
-		for_each_in(VkDescriptorSetLayout, layout, layouts, mvk->swap_chain_size) *layout = mvk->descriptor_set_layout;
-
-		VkDescriptorSetAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		alloc_info.descriptorPool = mvk->descriptor_pool;
-		alloc_info.descriptorSetCount = mvk->swap_chain_size;
-		alloc_info.pSetLayouts = layouts;
-
-		mvk->descriptor_sets = mam_stack_pusht(VkDescriptorSet, mvk->stack, mvk->swap_chain_size);
-		if(vkAllocateDescriptorSets(mvk->device, &alloc_info, mvk->descriptor_sets) != VK_SUCCESS) {
-			ERRORL("Failed to allocate vulkan descriptor sets\n");
-		}
-
-		for_each_lt(i, mvk->swap_chain_size) {
-			VkDescriptorBufferInfo buffer_info = {};
-			buffer_info.buffer = mvk->uniform_buffer;
-			buffer_info.offset = i*sizeof(UniformBufferObject);
-			buffer_info.range = sizeof(UniformBufferObject);
-
-			VkWriteDescriptorSet descriptor_write = {};
-			descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptor_write.dstSet = mvk->descriptor_sets[i];
-			descriptor_write.dstBinding = 0;
-			descriptor_write.dstArrayElement = 0;
-			descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptor_write.descriptorCount = 1;
-			descriptor_write.pBufferInfo = &buffer_info;
-			descriptor_write.pImageInfo = 0; // Optional
-			descriptor_write.pTexelBufferView = 0; // Optional
-
-			vkUpdateDescriptorSets(mvk->device, 1, &descriptor_write, 0, 0);
-		}
-	}
 }
 
 void create_pipeline(MvkData* mvk) {
@@ -496,7 +600,7 @@ void create_pipeline(MvkData* mvk) {
 
 	VkGraphicsPipelineCreateInfo pipeline_info = {};
 	pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipeline_info.stageCount = mvk->shader_stages_size;
+	pipeline_info.stageCount = 2;
 	pipeline_info.pStages = mvk->shader_stages;
 	pipeline_info.pVertexInputState = &vertex_info;
 	pipeline_info.pInputAssemblyState = &input_assembly;
@@ -515,8 +619,30 @@ void create_pipeline(MvkData* mvk) {
 	if(vkCreateGraphicsPipelines(mvk->device, VK_NULL_HANDLE, 1, &pipeline_info, 0, &mvk->pipeline) != VK_SUCCESS) {
 		ERRORL("Failed to create a vulkan graphics pipeline\n");
 	}
-	{//create buffers
-		mvk->frame_buffers = mam_stack_pusht(VkFramebuffer, mvk->stack, mvk->swap_chain_size);
+	mvk->boards_pipeline = VK_NULL_HANDLE;
+	if(mvk->shader_stages_size > 2) {//create the boards pipeline
+		//every instance is one Board, read as 2 uint32s, and the vertex shader makes its squares out of gl_VertexIndex alone
+		VkVertexInputBindingDescription board_description = {};
+		board_description.binding = 0;
+		board_description.stride = sizeof(Board);
+		board_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		VkVertexInputAttributeDescription board_attribute = {};
+		board_attribute.binding = 0;
+		board_attribute.location = 0;
+		board_attribute.format = VK_FORMAT_R32G32_UINT;
+		board_attribute.offset = 0;
+		vertex_info.pVertexBindingDescriptions = &board_description;
+		vertex_info.vertexAttributeDescriptionCount = 1;
+		vertex_info.pVertexAttributeDescriptions = &board_attribute;
+
+		VkPipelineShaderStageCreateInfo boards_stages[2] = {mvk->shader_stages[2], mvk->shader_stages[1]};
+		pipeline_info.pStages = boards_stages;
+		if(vkCreateGraphicsPipelines(mvk->device, VK_NULL_HANDLE, 1, &pipeline_info, 0, &mvk->boards_pipeline) != VK_SUCCESS) {
+			ERRORL("Failed to create the vulkan boards pipeline\n");
+		}
+	}
+	{//create frame buffers
+		mvk->frame_buffers = vstack_pusht(VkFramebuffer, mvk->stack, mvk->swap_chain_size);
 		for_each_lt(i, mvk->swap_chain_size) {
 			VkFramebufferCreateInfo frame_buffer_info = {};
 			frame_buffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -531,62 +657,59 @@ void create_pipeline(MvkData* mvk) {
 				ERRORL("Failed to create a vulkan frame buffer\n");
 			}
 		}
+	}
 
-		VkCommandBufferAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		alloc_info.commandPool = mvk->command_pool;
-		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandBufferCount = mvk->swap_chain_size;
-
-		mvk->command_buffers = mam_stack_pusht(VkCommandBuffer, mvk->stack, mvk->swap_chain_size);
-		if(vkAllocateCommandBuffers(mvk->device, &alloc_info, mvk->command_buffers) != VK_SUCCESS) {
-			ERRORL("Failed to allocate vulkan command buffers");
-		}
-
-		for_each_lt(i, mvk->swap_chain_size) {
-			VkCommandBufferBeginInfo begin_info = {};
-			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			begin_info.flags = 0; // Optional
-			begin_info.pInheritanceInfo = 0; // Optional
-
-			if(vkBeginCommandBuffer(mvk->command_buffers[i], &begin_info) != VK_SUCCESS) {
-				ERRORL("failed to begin recording command buffer!");
-			}
-			VkClearValue clear_color = {0.0f, 0.0f, 0.0f, 1.0f};
-
-			VkRenderPassBeginInfo render_begin_info = {};
-			render_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			render_begin_info.renderPass = mvk->render_pass;
-			render_begin_info.framebuffer = mvk->frame_buffers[i];
-			render_begin_info.renderArea.offset.x = 0;
-			render_begin_info.renderArea.offset.y = 0;
-			render_begin_info.renderArea.extent = mvk->swap_chain_image_extent;
-			render_begin_info.clearValueCount = 1;
-			render_begin_info.pClearValues = &clear_color;
-
-			vkCmdBeginRenderPass(mvk->command_buffers[i], &render_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-
+	//Set up memory to track images in flight fences, we have to do this here since we need mvk->swap_chain_size amount of memory for it
+	mvk->images_in_flight_fences = vstack_pusht(VkFence, mvk->stack, mvk->swap_chain_size);
+	for_each_lt(i, mvk->swap_chain_size) {
+		mvk->images_in_flight_fences[i] = VK_NULL_HANDLE;
+	}
+}
 
-			vkCmdBindPipeline(mvk->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mvk->pipeline);
-			VkDeviceSize offsets = 0;
-			int32 indices_size = INDEX_BUFFER_SIZE/sizeof(int32);
+void record_command_buffer(MvkData* mvk, int32 frame_i, uint32 image_i) {
+	MvkFrame* frame = &mvk->frames[frame_i];
+	VkCommandBuffer command_buffer = frame->command_buffer;
+	//the in flight fence for this frame has been waited on, so the gpu is done with this command buffer
+	vkResetCommandBuffer(command_buffer, 0);
 
-			vkCmdBindDescriptorSets(mvk->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mvk->pipeline_layout, 0, 1, &mvk->descriptor_sets[i], 0, 0);
-			vkCmdBindVertexBuffers(mvk->command_buffers[i], 0, 1, &mvk->vertex_buffer, &offsets);
-			vkCmdBindIndexBuffer(mvk->command_buffers[i], mvk->index_buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(mvk->command_buffers[i], indices_size, 1, 0, 0, 0);
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = 0; // Optional
 
-			vkCmdEndRenderPass(mvk->command_buffers[i]);
-			if(vkEndCommandBuffer(mvk->command_buffers[i]) != VK_SUCCESS) {
-				ERRORL("Failed to record to the vulkan command buffer");
-			}
-		}
+	if(vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+		ERRORL("failed to begin recording command buffer!");
+	}
+	VkClearValue clear_color = {0.0f, 0.0f, 0.0f, 1.0f};
+
+	VkRenderPassBeginInfo render_begin_info = {};
+	render_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_begin_info.renderPass = mvk->render_pass;
+	render_begin_info.framebuffer = mvk->frame_buffers[image_i];
+	render_begin_info.renderArea.offset.x = 0;
+	render_begin_info.renderArea.offset.y = 0;
+	render_begin_info.renderArea.extent = mvk->swap_chain_image_extent;
+	render_begin_info.clearValueCount = 1;
+	render_begin_info.pClearValues = &clear_color;
+
+	vkCmdBeginRenderPass(command_buffer, &render_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mvk->pipeline);
+	VkDeviceSize offsets = 0;
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mvk->pipeline_layout, 0, 1, &frame->descriptor_set, 0, 0);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &frame->vertex_buffer, &offsets);
+	vkCmdBindIndexBuffer(command_buffer, frame->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdDrawIndexed(command_buffer, frame->indices_size, 1, 0, 0, 0);
+	if(frame->instances_size > 0) {
+		//a whole wall of boards in one draw, 2 triangles for each of a board's cells
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mvk->boards_pipeline);
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, &frame->instance_buffer, &offsets);
+		vkCmdDraw(command_buffer, 6*BOARD_CELLS, frame->instances_size, 0, 0);
 	}
 
-	//Set up memory to track images in flight fences, we have to do this here since we need mvk->swap_chain_size amount of memory for it
-	mvk->images_in_flight_fences = mam_stack_pusht(VkFence, mvk->stack, mvk->swap_chain_size);
-	for_each_lt(i, mvk->swap_chain_size) {
-		mvk->images_in_flight_fences[i] = VK_NULL_HANDLE;
+	vkCmdEndRenderPass(command_buffer);
+	if(vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+		ERRORL("Failed to record to the vulkan command buffer");
 	}
 }
 
@@ -595,17 +718,13 @@ void recreate_swap_chain(MvkData* mvk, SDL_Window* window) {
 	{//clean up old swapchain
 		for_each_in(VkFramebuffer, frame_buffer, mvk->frame_buffers, mvk->swap_chain_size) vkDestroyFramebuffer(mvk->device, *frame_buffer, 0);
 
-		vkFreeCommandBuffers(mvk->device, mvk->command_pool, mvk->swap_chain_size, mvk->command_buffers);
-
 		vkDestroyPipeline(mvk->device, mvk->pipeline, 0);
+		vkDestroyPipeline(mvk->device, mvk->boards_pipeline, 0);
 		vkDestroyPipelineLayout(mvk->device, mvk->pipeline_layout, 0);
 		vkDestroyRenderPass(mvk->device, mvk->render_pass, 0);
 		for_each_in(VkImageView, image_view, mvk->swap_chain_image_views, mvk->swap_chain_size) vkDestroyImageView(mvk->device, *image_view, 0);
 		vkDestroySwapchainKHR(mvk->device, mvk->swap_chain, 0);
 
-		vkDestroyBuffer(mvk->device, mvk->uniform_buffer, 0);
-		vkFreeMemory(mvk->device, mvk->uniform_buffer_memory, 0);
-		vkDestroyDescriptorPool(mvk->device, mvk->descriptor_pool, 0);
 		mam_stack_set_size(mvk->stack, mvk->swap_chain_mem_start);
 	}
 	find_device_capabilities(mvk, window);
@@ -617,541 +736,108 @@ void recreate_swap_chain(MvkData* mvk, SDL_Window* window) {
 
 
 
-void game_free_recursively(GameMemDesc* desc) {
-	for_each_lt(i, desc->children_total) {
-		GameMemDesc* child = &cast(GameMemDesc*, desc->mem)[i];
-
-		if(!(child->flags & GAME_MEMDESC_INTERNAL)) {
-			game_free_recursively(child);
-		}
-	}
-	free(desc->mem);
-	desc->mem = 0;
-}
-//NOTE: all memory for the game's internals should be allocated through this function
-GameMemDesc alloc_game_mem(inta alloc_size, int children_total, uint flags) {
-	GameMemDesc desc;
-	desc.mem = malloc(alloc_size);
-	desc.alloc_size = alloc_size;
-	desc.children_total = children_total;
-	desc.flags = flags;
-	#ifdef DEBUG
-		memset(desc.mem, ~((char)0), alloc_size);
-	#endif
-	return desc;
-}
-
-void game_2048_init_grid(Game* game) {
-	memzero(game->grid, game->grid_h*game->grid_w);
-	int32 v = pcg_random_in(&game->rng, 1, 2);
-	int32 x = pcg_random_in(&game->rng, 0, game->grid_w - 1);
-	int32 y = pcg_random_in(&game->rng, 0, game->grid_h - 1);
-	game->grid[x + game->grid_w*y] = v;
-}
-GameMemDesc game_new() {
-	GameMemDesc game_mem_desc = alloc_game_mem(GAME_STACK_SIZE, 2, 0);
-
-	Game* game = (Game*)game_mem_desc.mem;
-	memzero(game, 1);
-
-	game->stack_desc.mem = ptr_add(void, game, sizeof(Game));
-	game->stack_desc.alloc_size = GAME_STACK_SIZE - sizeof(Game);
-	game->stack_desc.children_total = 0;
-	game->stack_desc.flags = GAME_MEMDESC_INTERNAL;
-	mam_stack_init(game->stack_desc.mem, game->stack_desc.alloc_size);
-
-	game->temp_stack_desc = alloc_game_mem(TEMP_STACK_SIZE, 0, GAME_MEMDESC_TEMP);
-	mam_stack_init(game->temp_stack_desc.mem, game->temp_stack_desc.alloc_size);
-
-	//TODO: find a better rng seed
-	pcg_seed(&game->rng, 12);
-
-	game->lifetime = 0.0;
-	game->do_draw = 1;
-
-	{//init game state
-		game->colors_size = 12;
-		game->colors = mam_stack_pusht(gbVec3, game->stack, game->colors_size);
-		game->colors[0] = {1.0f, 1.0f, 1.0f};
-		for_each_in_range(i, 1, game->colors_size - 1) {
-			float t = (i - 1.0f)/(game->colors_size - 2.0f);
-			if(t <= .5) {
-				t *= 2;
-				game->colors[i].r = t;
-				game->colors[i].g = 0.05;
-				game->colors[i].b = 1.0f - t;
-			} else {
-				t = 2*t - 1;
-				game->colors[i].r = 1.0f - t;
-				game->colors[i].g = t;
-				game->colors[i].b = 0.05;
-			}
-		}
-
-		game->state = GAME_STATE_2048;
+#include "game.hh"
+#include "module.hh"
 
-		game->grid_w = 4;
-		game->grid_h = 4;
-		game->grid = mam_stack_pusht(int32, game->stack, game->grid_h*game->grid_w);
-		game_2048_init_grid(game);
 
-		game->anim_queue_max_size = 4;
-		game->anim_queue_start = 0;
-		game->anim_queue_end = 0;
-		game->anim_queue_moves = mam_stack_pusht(int32, game->stack, game->anim_queue_max_size);
-		game->anim_queue_grids = mam_stack_pusht(int32, game->stack, game->anim_queue_max_size*game->grid_h*game->grid_w);
-		game->anim_queue_grid_dist = mam_stack_pusht(int32, game->stack, game->anim_queue_max_size*game->grid_h*game->grid_w);
-		game->anim_t = 0;
-	}
 
-	return game_mem_desc;
+int32 poll_events(SDL_Event* events, int32 capacity) {
+	SDL_PumpEvents();
+	int32 events_size = SDL_PeepEvents(events, capacity, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+	return max(events_size, 0);
 }
 
-Output game_update(Game* game, double delta) {
-	Output output = {};
-
-	{//clear transient data
-		mam_stack_set_size(game->temp_stack, 0);
-		game->input_left_just_down = 0;
-		game->input_right_just_down = 0;
-		game->input_up_just_down = 0;
-		game->input_down_just_down = 0;
-	}
-
-	SDL_Event event;
-	while(SDL_PollEvent(&event)) {
-		if(event.type == SDL_QUIT) {
-			output.game_quit = 1;
-			break;
-		} else if(event.type == SDL_TEXTINPUT) {
-		} else if(event.type == SDL_TEXTEDITING) {
-		} else if(event.type == SDL_MOUSEMOTION) {
-		} else if(event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP) {
-			if(event.button.button == SDL_BUTTON_LEFT) {
-			} else if(event.button.button == SDL_BUTTON_RIGHT) {
-			} else if(event.button.button == SDL_BUTTON_MIDDLE) {
-			}
-		} else if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
-			auto scancode = event.key.keysym.scancode;
-			auto keycode = event.key.keysym.sym;
-			bool is_down = (event.key.state == SDL_PRESSED);
-			bool is_repeat = (event.key.repeat > 0);
-			//TODO: Support full suite of keys
-			if(is_down) {
-				if(keycode == SDLK_ESCAPE) {
-					output.game_quit = 1;
-					break;
-					// } else if(keycode == SDLK_BACKSPACE) {
-					// 	input_add_char(&input, CHAR_BACKSPACE, startup_stack);
-					// } else if(keycode == SDLK_DELETE) {
-					// 	input_add_char(&input, CHAR_DELETE, startup_stack);
-					// } else if(keycode == SDLK_TAB) {
-					// 	input_add_char(&input, CHAR_TAB, startup_stack);
-					// } else if(keycode == SDLK_RETURN) {
-					// 	//NOTE: there's a SDLK_RETURN2??
-					// 	input_add_char(&input, CHAR_RETURN, startup_stack);
-					// } else if(keycode == SDLK_DOWN) {
-					// 	input_add_char(&input, CHAR_DOWN, startup_stack);
-					// } else if(keycode == SDLK_UP) {
-					// 	input_add_char(&input, CHAR_UP, startup_stack);
-					// } else if(keycode == SDLK_RIGHT) {
-					// 	input_add_char(&input, CHAR_RIGHT, startup_stack);
-					// } else if(keycode == SDLK_LEFT) {
-					// 	//NOTE: there's a SDLK_RETURN2??
-					// 	input_add_char(&input, CHAR_LEFT, startup_stack);
-				} else {
-				}
-			} else {
-			}
-			if(!is_repeat) {
-				if(keycode == SDLK_LEFT) {
-					game->input_left_just_down |= is_down & !game->input_left_down;
-					game->input_left_down = is_down;
-				} else if(keycode == SDLK_RIGHT) {
-					game->input_right_just_down |= is_down & !game->input_right_down;
-					game->input_right_down = is_down;
-				} else if(keycode == SDLK_UP) {
-					game->input_up_just_down |= is_down & !game->input_up_down;
-					game->input_up_down = is_down;
-				} else if(keycode == SDLK_DOWN) {
-					game->input_down_just_down |= is_down & !game->input_down_down;
-					game->input_down_down = is_down;
-				} else if(keycode == SDLK_LSHIFT) {
-				} else if(keycode == SDLK_LCTRL) {
-				} else if(keycode == SDLK_0) {
-				} else if(keycode == SDLK_1) {
-				} else if(keycode == SDLK_2) {
-				} else if(keycode == SDLK_3) {
-				} else if(keycode == SDLK_4) {
-				} else if(keycode == SDLK_5) {
-				} else if(keycode == SDLK_6) {
-				} else if(keycode == SDLK_7) {
-				} else if(keycode == SDLK_8) {
-				} else if(keycode == SDLK_9) {
-				}
-			}
-		} else if (event.type == SDL_WINDOWEVENT) {
-			auto window_id = event.window.event;
-			if (window_id == SDL_WINDOWEVENT_CLOSE) {
-				output.game_quit = 1;
-				break;
-			} else if(window_id == SDL_WINDOWEVENT_SIZE_CHANGED) {
-				output.window_resize = 1;
-			} else if (window_id == SDL_WINDOWEVENT_SHOWN) {
-				game->do_draw = 1;
-			} else if (window_id == SDL_WINDOWEVENT_HIDDEN) {
-				game->do_draw = 0;
-			} else if (window_id == SDL_WINDOWEVENT_MINIMIZED) {
-				game->do_draw = 0;
-			} else if (window_id == SDL_WINDOWEVENT_MAXIMIZED) {
-			} else if (window_id == SDL_WINDOWEVENT_EXPOSED) {
-				game->do_draw = 1;
-			} else if (window_id == SDL_WINDOWEVENT_ENTER) {
-			} else if (window_id == SDL_WINDOWEVENT_LEAVE) {
-			} else if (window_id == SDL_WINDOWEVENT_FOCUS_GAINED) {
-			} else if (window_id == SDL_WINDOWEVENT_FOCUS_LOST) {
-			}
-		}
-	}
-	if(output.game_quit) return output;
-
-	if(game->state == GAME_STATE_2048) {//update game
-		bool has_cell_moved = 0;
-		int32* grid_dist = 0;
-		if(game->input_down_just_down | game->input_up_just_down | game->input_left_just_down | game->input_right_just_down) {//will move
-			//submit movement data to the animation queue
-			game->anim_queue_moves[game->anim_queue_end] = MOVE_LEFT;
-			memcopy(&game->anim_queue_grids[game->anim_queue_end*game->grid_w*game->grid_h], &game->grid, game->grid_w*game->grid_h);
-			grid_dist = &game->anim_queue_grid_dist[game->anim_queue_end*game->grid_w*game->grid_h];
-			memzero(grid_dist, game->grid_w*game->grid_h);
-
-			game->anim_queue_end = (game->anim_queue_end + 1)%game->anim_queue_max_size;
-		}
-		if(game->input_left_just_down) {
-			for_each_in_range(x, 1, game->grid_w - 1) {
-				for_each_lt(y, game->grid_h) {
-					int32* v = &game->grid[x + game->grid_w*y];
-					int32* d = &grid_dist[x + game->grid_w*y];
-					if(*v == 0) continue;
-					for_each_in_range_bw(coll_x, 0, x - 1) {
-						int32* coll_v = &game->grid[coll_x + game->grid_w*y];
-						if(*coll_v == 0) {
-							*coll_v = *v;
-							*v = 0;
-							v = coll_v;
-							has_cell_moved = 1;
-							*d += 1;
-						} else if(*coll_v == *v) {
-							*coll_v += 1;
-							*v = 0;
-							has_cell_moved = 1;
-							*d += 1;
-							break;
-						} else {
-							break;
-						}
-					}
-				}
-			}
-		} else if(game->input_right_just_down) {
-			for_each_in_range_bw(x, 0, game->grid_w - 2) {
-				for_each_lt(y, game->grid_h) {
-					int32* v = &game->grid[x + game->grid_w*y];
-					int32* d = &grid_dist[x + game->grid_w*y];
-					if(*v == 0) continue;
-					for_each_in_range(coll_x, x + 1, game->grid_w - 1) {
-						int32* coll_v = &game->grid[coll_x + game->grid_w*y];
-						if(*coll_v == 0) {
-							*coll_v = *v;
-							*v = 0;
-							v = coll_v;
-							has_cell_moved = 1;
-							*d += 1;
-						} else if(*coll_v == *v) {
-							*coll_v += 1;
-							*v = 0;
-							has_cell_moved = 1;
-							*d += 1;
-							break;
-						} else {
-							break;
-						}
-					}
-				}
-			}
-		} else if(game->input_up_just_down) {
-			for_each_in_range(y, 0, game->grid_h - 1) {
-				for_each_lt(x, game->grid_w) {
-					int32* v = &game->grid[x + game->grid_w*y];
-					int32* d = &grid_dist[x + game->grid_w*y];
-					if(*v == 0) continue;
-					for_each_in_range_bw(coll_y, 0, y - 1) {
-						int32* coll_v = &game->grid[x + game->grid_w*coll_y];
-						if(*coll_v == 0) {
-							*coll_v = *v;
-							*v = 0;
-							v = coll_v;
-							has_cell_moved = 1;
-							*d += 1;
-						} else if(*coll_v == *v) {
-							*coll_v += 1;
-							*v = 0;
-							has_cell_moved = 1;
-							*d += 1;
-							break;
-						} else {
-							break;
-						}
-					}
-				}
-			}
-		} else if(game->input_down_just_down) {
-			for_each_in_range_bw(y, 0, game->grid_h - 2) {
-				for_each_lt(x, game->grid_w) {
-					int32* v = &game->grid[x + game->grid_w*y];
-					int32* d = &grid_dist[x + game->grid_w*y];
-					if(*v == 0) continue;
-					for_each_in_range(coll_y, y + 1, game->grid_h - 1) {
-						int32* coll_v = &game->grid[x + game->grid_w*coll_y];
-						if(*coll_v == 0) {
-							*coll_v = *v;
-							*v = 0;
-							v = coll_v;
-							has_cell_moved = 1;
-							*d += 1;
-						} else if(*coll_v == *v) {
-							*coll_v += 1;
-							*v = 0;
-							has_cell_moved = 1;
-							*d += 1;
-							break;
-						} else {
-							break;
-						}
-					}
-				}
-			}
-		}
-		if(has_cell_moved) {
-			int32** empty_cells = mam_stack_pusht(int32*, game->temp_stack, game->grid_h*game->grid_w);
-			int32 empty_cells_size = 0;
-			for_each_lt(y, game->grid_h) {
-				for_each_lt(x, game->grid_w) {
-					int32* v = &game->grid[x + game->grid_w*y];
-					if(*v == 0) {
-						empty_cells[empty_cells_size] = v;
-						empty_cells_size += 1;
-					}
-				}
-			}
-			if(empty_cells_size > 0) {
-				*empty_cells[pcg_random_in(&game->rng, 0, empty_cells_size - 1)] = pcg_random_in(&game->rng, 1, 2);
-			}
-			if(empty_cells_size <= 1) {
-				bool has_a_move_left = 0;
-				for_each_lt(y, game->grid_h) {
-					for_each_lt(x, game->grid_w) {
-						int32 v = game->grid[x + game->grid_w*y];
-						if(y + 1 < game->grid_h) {
-							int32 u = game->grid[x + game->grid_w*(y + 1)];
-							if(v == u) {
-								has_a_move_left = 1;
-								break;
-							}
-						}
-						if(x + 1 < game->grid_w) {
-							int32 u = game->grid[(x + 1) + game->grid_w*y];
-							if(v == u) {
-								has_a_move_left = 1;
-								break;
-							}
-						}
-					}
-					if(has_a_move_left) break;
-				}
-				if(!has_a_move_left) {
-					game->state = GAME_STATE_GAME_OVER;
-					game->game_over_timer = 0;
-				}
-			}
-		}
-	} else if(game->state == GAME_STATE_GAME_OVER) {
-		if(game->game_over_timer >= 1.5) {
-			if(game->input_down_just_down | game->input_up_just_down | game->input_left_just_down | game->input_right_just_down) {
-				game->state = GAME_STATE_2048;
-				game_2048_init_grid(game);
-			}
-		} else {
-			game->game_over_timer += delta;
-		}
+static int32 push_move_events(SDL_Event* events, int32 capacity, int32 move) {
+	//autoplay presses the same keys a player would, so recordings of it replay exactly without the solver
+	if(capacity < 2) return 0;
+	SDL_Keycode keycode = SDLK_UNKNOWN;
+	if(move == MOVE_LEFT) {
+		keycode = SDLK_LEFT;
+	} else if(move == MOVE_RIGHT) {
+		keycode = SDLK_RIGHT;
+	} else if(move == MOVE_UP) {
+		keycode = SDLK_UP;
+	} else if(move == MOVE_DOWN) {
+		keycode = SDLK_DOWN;
+	} else {
+		return 0;
 	}
-
-
-	game->lifetime += delta;
-
-	output.do_draw = game->do_draw;
-	return output;
+	memzero(events, 2);
+	events[0].type = SDL_KEYDOWN;
+	events[0].key.state = SDL_PRESSED;
+	events[0].key.timestamp = SDL_GetTicks();
+	events[0].key.keysym.sym = keycode;
+	events[1] = events[0];
+	events[1].type = SDL_KEYUP;
+	events[1].key.state = SDL_RELEASED;
+	return 2;
 }
 
-
-void game_render(Game* game, double delta, MvkData* mvk, uint32 image_i) {
-
-	int32 vbuffer_size = VERTEX_BUFFER_SIZE;
-	VkBuffer staging_vbuffer;
-	VkDeviceMemory staging_vbuffer_memory;
-	create_buffer(mvk, vbuffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_vbuffer, &staging_vbuffer_memory);
-
-	int32 ibuffer_size = INDEX_BUFFER_SIZE;
-	VkBuffer staging_ibuffer;
-	VkDeviceMemory staging_ibuffer_memory;
-	create_buffer(mvk, ibuffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_ibuffer, &staging_ibuffer_memory);
-
-	//transfer to vertex buffer
-	byte* vbuffer;
-	byte* ibuffer;
-	byte* ubuffer;
-	int32 vbuffer_i = 0;
-	int32 ibuffer_i = 0;
-	int32 ubuffer_i = 0;
-	vkMapMemory(mvk->device, staging_vbuffer_memory, 0, vbuffer_size, 0, (void**)&vbuffer);
-	vkMapMemory(mvk->device, staging_ibuffer_memory, 0, ibuffer_size, 0, (void**)&ibuffer);
-	vkMapMemory(mvk->device, mvk->uniform_buffer_memory, image_i*sizeof(UniformBufferObject), sizeof(UniformBufferObject), 0, (void**)&ubuffer);
-
-
-	{//fill gpu buffers
-		float screen_w = mvk->swap_chain_image_extent.width;
-		float screen_h = mvk->swap_chain_image_extent.height;
-		float pixel_l = min(screen_w, screen_h);
-
-
-		// int32* render_grid = 0;
-		// int32* render_grid_dist = 0;
-		int32 anim_move = MOVE_NONE;
-		// float anim_t = 0;
-		// int32 anim_queue_size = (game->anim_queue_end - game->anim_queue_start + game->anim_queue_max_size)%game->anim_queue_max_size;
-		// if(anim_queue_size > 0) {
-		// 	game->anim_t += delta/1.5;
-		// 	while(game->anim_t >= 1.0) {
-		// 		game->anim_t -= 1.0;
-		// 		game->anim_queue_start = (game->anim_queue_start + 1)%game->anim_queue_max_size;
-		// 		anim_queue_size = (game->anim_queue_end - game->anim_queue_start + game->anim_queue_max_size)%game->anim_queue_max_size;
-		// 		if(anim_queue_size == 0) {
-		// 			game->anim_t = 0;
-		// 			break;
-		// 		}
-		// 	}
-		// 	if(anim_queue_size > 0) {
-		// 		render_grid = &game->anim_queue_grids[game->anim_queue_start*game->grid_w*game->grid_h];
-		// 		render_grid_dist = &game->anim_queue_grid_dist[game->anim_queue_start*game->grid_w*game->grid_h];
-		// 		anim_move = game->anim_queue_moves[game->anim_queue_start];
-		// 		anim_t = game->anim_t;
-		// 	}
-		// }
-
-		float square_base_l = gb_floor(pixel_l/4);
-		float square_l = square_base_l - 20;
-		if(anim_move == MOVE_UP) {
-
-		} else if(anim_move == MOVE_DOWN) {
-
-		} else if(anim_move == MOVE_LEFT) {
-
-		} else if(anim_move == MOVE_RIGHT) {
-			// for_each_lt(y, game->grid_h) {
-				// for_each_lt(x, game->grid_w) {
-					// int32 v = render_grid[x + game->grid_w*y];
-					// int32 d = render_grid_dist[x + game->grid_w*y];
-					// float square_x = square_base_l*(x - d*anim_t) + 10;
-					// float square_y = square_base_l*y + 10;
-					// gbVec3 color = game->colors[min(game->colors_size - 1, v)];
-					// Vertex square[4] = {
-						// {{square_x, square_y}, color},
-						// {{square_x + square_l, square_y}, color},
-						// {{square_x + square_l, square_y + square_l}, color},
-						// {{square_x, square_y + square_l}, color}
-					// };
-					// int32 base_i = vbuffer_i/sizeof(Vertex);
-					// int32 square_is[6] = {
-						// base_i, base_i + 1, base_i + 2, base_i + 2, base_i + 3, base_i
-					// };
-					// memcpy(vbuffer + vbuffer_i, square, 4*sizeof(Vertex));
-					// vbuffer_i += 4*sizeof(Vertex);
-					// memcpy(ibuffer + ibuffer_i, square_is, 6*sizeof(int32));
-					// ibuffer_i += 6*sizeof(int32);
-				// }
-			// }
-		} else {
-			for_each_lt(y, game->grid_h) {
-				for_each_lt(x, game->grid_w) {
-					int32 v = game->grid[x + game->grid_w*y];
-					float square_x = square_base_l*x + 10;
-					float square_y = square_base_l*y + 10;
-					gbVec3 color = game->colors[min(game->colors_size - 1, v)];
-					Vertex square[4] = {
-						{{square_x, square_y}, color},
-						{{square_x + square_l, square_y}, color},
-						{{square_x + square_l, square_y + square_l}, color},
-						{{square_x, square_y + square_l}, color}
-					};
-					int32 base_i = vbuffer_i/sizeof(Vertex);
-					int32 square_is[6] = {
-						base_i, base_i + 1, base_i + 2, base_i + 2, base_i + 3, base_i
-					};
-					memcpy(vbuffer + vbuffer_i, square, 4*sizeof(Vertex));
-					vbuffer_i += 4*sizeof(Vertex);
-					memcpy(ibuffer + ibuffer_i, square_is, 6*sizeof(int32));
-					ibuffer_i += 6*sizeof(int32);
-				}
-			}
-		}
-
-
-		UniformBufferObject ubo;
-		gb_mat4_identity(&ubo.model);
-		if(screen_w >= screen_h) {
-			ubo.model.w.x += (screen_w - screen_h)/2.0f;
-		} else {
-			ubo.model.w.y += (screen_h - screen_w)/2.0f;
+#include "solver.hh"
+#include "montecarlo.hh"
+#include "replay.hh"
+
+int main(int argc, char** argv) {
+	uint64 seed = DEFAULT_SEED;
+	int32 grid_w = DEFAULT_GRID_SIZE;
+	int32 grid_h = DEFAULT_GRID_SIZE;
+	char* record_filename = 0;
+	char* load_filename = 0;
+	int32 wall_size = 0;
+	for_each_in_range(i, 1, argc - 1) {
+		MamString arg = mam_tostr(argv[i]);
+		if(mam_cstreq(arg, "--replay") && i + 1 < argc) {
+			//headless playback, the game never opens a window in this mode
+			int32 loops = 1;
+			if(i + 2 < argc) mam_strtoint32(mam_tostr(argv[i + 2]), &loops);
+			return replay_playback(argv[i + 1], max(loops, 1));
+		} else if(mam_cstreq(arg, "--record") && i + 1 < argc) {
+			record_filename = argv[i + 1];
+			i += 1;
+		} else if(mam_cstreq(arg, "--wall") && i + 1 < argc) {
+			mam_strtoint32(mam_tostr(argv[i + 1]), &wall_size);
+			wall_size = gb_clamp(wall_size, 0, WALL_SIZE_MAX);
+			i += 1;
+		} else if(mam_cstreq(arg, "--load") && i + 1 < argc) {
+			load_filename = argv[i + 1];
+			i += 1;
+		} else if(mam_cstreq(arg, "--seed") && i + 1 < argc) {
+			mam_strtouint64(mam_tostr(argv[i + 1]), &seed);
+			i += 1;
+		} else if(mam_cstreq(arg, "--grid") && i + 2 < argc) {
+			mam_strtoint32(mam_tostr(argv[i + 1]), &grid_w);
+			mam_strtoint32(mam_tostr(argv[i + 2]), &grid_h);
+			grid_w = gb_clamp(grid_w, 2, GRID_SIZE_MAX);
+			grid_h = gb_clamp(grid_h, 2, GRID_SIZE_MAX);
+			i += 2;
 		}
-		ubo.model.x.x *= 2.0f/screen_w;
-		ubo.model.w.x *= 2.0f/screen_w;
-		ubo.model.y.y *= 2.0f/screen_h;
-		ubo.model.w.y *= 2.0f/screen_h;
-		ubo.model.w.x += -1.0f;
-		ubo.model.w.y += -1.0f;
-
-		memcpy(ubuffer, &ubo, sizeof(UniformBufferObject));
-		ubuffer_i += sizeof(UniformBufferObject);
 	}
-
-	vkUnmapMemory(mvk->device, staging_vbuffer_memory);
-	vkUnmapMemory(mvk->device, staging_ibuffer_memory);
-	vkUnmapMemory(mvk->device, mvk->uniform_buffer_memory);
-	copy_buffer(mvk, mvk->vertex_buffer, staging_vbuffer, vbuffer_i);
-	copy_buffer(mvk, mvk->index_buffer, staging_ibuffer, ibuffer_i);
-	vkDestroyBuffer(mvk->device, staging_vbuffer, 0);
-	vkDestroyBuffer(mvk->device, staging_ibuffer, 0);
-	vkFreeMemory(mvk->device, staging_vbuffer_memory, 0);
-	vkFreeMemory(mvk->device, staging_ibuffer_memory, 0);
-}
-
-
-
-int main() {
 	//there are only 2 exit points for this program, the return from the bottom of main and main_trap
 	MainTrash trash = {};
 	mam_set_error_trap(main_trap, &trash);
 
 	gbVec2 window_dim = gb_vec2(1200, 800);
 	SDL_Window* window = 0;
-	double time_per_frame = DEFAULT_FPS;
+	FramePacing pacing = {};
+	LatencyStats latency = {};
 
 	MvkData mvk_mem = {};
 	MvkData* mvk = &mvk_mem;
 	trash.mvk = mvk;
 
-	mvk->stack = mam_stack_init(malloc(MEGABYTE), MEGABYTE);
-	trash.ptrs[0] = mvk->stack;
+	#ifdef MEMPROF
+	memprof_init();
+	memprof_name_allocator(mam_system_allocator, "system", 0);
+	memprof_name_allocator(mam_stack_allocator, "stack", 1);
+	memprof_name_allocator(vstack_allocator, "vstack", 1);
+	memprof_name_allocator(pool_allocator, "pool", 0);
+	memprof_name_allocator(pool_cache_allocator, "pool cache", 0);
+	#endif
+	scratch_init();
+	mvk->stack = vstack_new(MVK_STACK_SIZE);
+	#ifdef MEMPROF
+	memprof_track_stack(mvk->stack, "vulkan");
+	#endif
 	{//init
 		uint32 sdlvk_extensions_size;
 		const char** sdlvk_extensions;
@@ -1173,17 +859,10 @@ int main() {
 			}
 			trash.window = window;
 
-			int display_index = SDL_GetWindowDisplayIndex(window);
-			SDL_DisplayMode dm;
-			//TODO: handle change in monitor
-			if(SDL_GetDesktopDisplayMode(display_index, &dm) < 0) {
-				printf("SDL_GetDesktopDisplayMode failed: %s\n", SDL_GetError());
-			} else {
-				time_per_frame = 1.0/dm.refresh_rate;
-			}
+			pacing_reset(&pacing, SDL_GetWindowDisplayIndex(window));
 
 			SDL_Vulkan_GetInstanceExtensions(window, &sdlvk_extensions_size, 0);
-			sdlvk_extensions = mam_stack_pusht(const char*, mvk->stack, sdlvk_extensions_size);
+			sdlvk_extensions = vstack_pusht(const char*, mvk->stack, sdlvk_extensions_size);
 			SDL_Vulkan_GetInstanceExtensions(window, &sdlvk_extensions_size, sdlvk_extensions);
 		}
 		uint32 mvk_desired_layers_size = 0;
@@ -1191,15 +870,15 @@ int main() {
 		{//instance and surface creation
 			uint32 mvk_extensions_size = 0;
 			vkEnumerateInstanceExtensionProperties(0, &mvk_extensions_size, 0);
-			VkExtensionProperties* mvk_extensions = mam_stack_pusht(VkExtensionProperties, mvk->stack, mvk_extensions_size);
+			VkExtensionProperties* mvk_extensions = vstack_pusht(VkExtensionProperties, mvk->stack, mvk_extensions_size);
 			vkEnumerateInstanceExtensionProperties(0, &mvk_extensions_size, mvk_extensions);
 
 			uint32 mvk_layers_size = 0;
 			vkEnumerateInstanceLayerProperties(&mvk_layers_size, 0);
-			VkLayerProperties* mvk_layers = mam_stack_pusht(VkLayerProperties, mvk->stack, mvk_layers_size);
+			VkLayerProperties* mvk_layers = vstack_pusht(VkLayerProperties, mvk->stack, mvk_layers_size);
 			vkEnumerateInstanceLayerProperties(&mvk_layers_size, mvk_layers);
 
-			mvk_desired_layers = mam_stack_pusht(char*, mvk->stack, 0);
+			mvk_desired_layers = vstack_pusht(char*, mvk->stack, 0);
 			#ifdef DEBUG
 			for_each_in(char*, desired_debug_layer, MVK_DEBUG_LAYERS, MVK_DEBUG_LAYERS_SIZE) {
 				int flag = 1;
@@ -1207,7 +886,7 @@ int main() {
 					if(mam_streq(mam_tostr(*desired_debug_layer), mam_tostr(layer->layerName))) {
 						flag = 0;
 						mvk_desired_layers_size += 1;
-						mam_stack_extend(mvk->stack, mvk_desired_layers, sizeof(*mvk_desired_layers)*mvk_desired_layers_size);
+						vstack_extend(mvk->stack, mvk_desired_layers, sizeof(*mvk_desired_layers)*mvk_desired_layers_size);
 						mvk_desired_layers[mvk_desired_layers_size - 1] = *desired_debug_layer;
 					}
 				}
@@ -1263,14 +942,15 @@ int main() {
 		}
 		{//pick physical device
 			mvk->physical_device = VK_NULL_HANDLE;
+			ScratchMark devices_mark = scratch_begin();
 			uint32 mvk_devices_size = 0;
 			vkEnumeratePhysicalDevices(mvk->instance, &mvk_devices_size, 0);
-			VkPhysicalDevice* mvk_devices = mam_stack_pusht(VkPhysicalDevice, mvk->stack, mvk_devices_size);
+			VkPhysicalDevice* mvk_devices = scratch_pusht(VkPhysicalDevice, devices_mark, mvk_devices_size);
 			vkEnumeratePhysicalDevices(mvk->instance, &mvk_devices_size, mvk_devices);
 
 			int highest_rating = 0;
 			for_each_index(VkPhysicalDevice, i, device, mvk_devices, mvk_devices_size) {
-				inta mvk_stack_size = mvk->stack->size;
+				ScratchMark mark = scratch_begin();
 
 				VkPhysicalDeviceProperties properties = {};
 				VkPhysicalDeviceFeatures features = {};
@@ -1279,12 +959,12 @@ int main() {
 
 				uint32_t device_extensions_size = 0;
 				vkEnumerateDeviceExtensionProperties(*device, 0, &device_extensions_size, 0);
-				VkExtensionProperties* device_extensions = mam_stack_pusht(VkExtensionProperties, mvk->stack, device_extensions_size);
+				VkExtensionProperties* device_extensions = scratch_pusht(VkExtensionProperties, mark, device_extensions_size);
 				vkEnumerateDeviceExtensionProperties(*device, 0, &device_extensions_size, device_extensions);
 
 				uint32 mvk_queues_size = 0;
 				vkGetPhysicalDeviceQueueFamilyProperties(*device, &mvk_queues_size, 0);
-				VkQueueFamilyProperties* mvk_queues = mam_stack_pusht(VkQueueFamilyProperties, mvk->stack, mvk_queues_size);
+				VkQueueFamilyProperties* mvk_queues = scratch_pusht(VkQueueFamilyProperties, mark, mvk_queues_size);
 				vkGetPhysicalDeviceQueueFamilyProperties(*device, &mvk_queues_size, mvk_queues);
 
 				int rating = 1;
@@ -1312,8 +992,15 @@ int main() {
 				}
 				// check for extensions
 				rating *= has_required_extensions;
+				bool has_display_timing = 0;
+				for_each_in(VkExtensionProperties, extension, device_extensions, device_extensions_size) {
+					if(mam_streq(mam_tostr(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME), mam_tostr(extension->extensionName))) {
+						has_display_timing = 1;
+						break;
+					}
+				}
 				if(rating <= 0) {
-					mam_stack_set_size(mvk->stack, mvk_stack_size);
+					scratch_end(&mark);
 					continue;
 				}
 
@@ -1327,7 +1014,7 @@ int main() {
 				vkGetPhysicalDeviceSurfacePresentModesKHR(*device, mvk->surface, &present_modes_size, 0);
 				rating *= present_modes_size > 0 && formats_size > 0;
 				if(rating <= 0) {
-					mam_stack_set_size(mvk->stack, mvk_stack_size);
+					scratch_end(&mark);
 					continue;
 				}
 
@@ -1350,7 +1037,7 @@ int main() {
 				// device must support drawing and presenting
 				rating *= best_draw_queue_i >= 0 & best_present_queue_i >= 0;
 				if(!rating) {
-					mam_stack_set_size(mvk->stack, mvk_stack_size);
+					scratch_end(&mark);
 					continue;
 				}
 
@@ -1359,9 +1046,11 @@ int main() {
 					mvk->physical_device = *device;
 					mvk->draw_queue_i = best_draw_queue_i;
 					mvk->present_queue_i = best_present_queue_i;
+					mvk->has_display_timing = has_display_timing;
 				}
-				mam_stack_set_size(mvk->stack, mvk_stack_size);
+				scratch_end(&mark);
 			}
+			scratch_end(&devices_mark);
 			if(mvk->physical_device == VK_NULL_HANDLE) {
 				MAM_ERRORL("Could not find an adequate vulkan compatible gpu\n");
 			}
@@ -1389,8 +1078,19 @@ int main() {
 			mvk_device_info.pEnabledFeatures = &mvk_device_features;
 			mvk_device_info.enabledLayerCount = mvk_desired_layers_size;
 			mvk_device_info.ppEnabledLayerNames = mvk_desired_layers;
-			mvk_device_info.enabledExtensionCount = MVK_DEVICE_EXTENSIONS_SIZE;
-			mvk_device_info.ppEnabledExtensionNames = MVK_DEVICE_EXTENSIONS;
+			//optional extensions are appended after the required ones
+			const char* device_extensions[MVK_DEVICE_EXTENSIONS_SIZE + 1];
+			uint32 device_extensions_size = 0;
+			for_each_in(char*, extension, MVK_DEVICE_EXTENSIONS, MVK_DEVICE_EXTENSIONS_SIZE) {
+				device_extensions[device_extensions_size] = *extension;
+				device_extensions_size += 1;
+			}
+			if(mvk->has_display_timing) {
+				device_extensions[device_extensions_size] = VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME;
+				device_extensions_size += 1;
+			}
+			mvk_device_info.enabledExtensionCount = device_extensions_size;
+			mvk_device_info.ppEnabledExtensionNames = device_extensions;
 
 			if(vkCreateDevice(mvk->physical_device, &mvk_device_info, 0, &mvk->device) != VK_SUCCESS) {
 				MAM_ERRORL("Failed to create a vulkan logical device\n");
@@ -1398,9 +1098,14 @@ int main() {
 
 			vkGetDeviceQueue(mvk->device, mvk->draw_queue_i, 0, &mvk->draw_queue);
 			vkGetDeviceQueue(mvk->device, mvk->present_queue_i, 0, &mvk->present_queue);
+
+			if(mvk->has_display_timing) {
+				mvk->get_past_presentation_timing = (PFN_vkGetPastPresentationTimingGOOGLE)vkGetDeviceProcAddr(mvk->device, "vkGetPastPresentationTimingGOOGLE");
+				mvk->has_display_timing = mvk->get_past_presentation_timing != 0;
+			}
 		}
 		{//create semaphores and fences
-			VkSemaphore* sems = mam_stack_pusht(VkSemaphore, mvk->stack, 2*MVK_FRAMES_IN_FLIGHT);
+			VkSemaphore* sems = vstack_pusht(VkSemaphore, mvk->stack, 2*MVK_FRAMES_IN_FLIGHT);
 			VkSemaphoreCreateInfo semaphore_info = {};
 			semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 			for_each_lt(i, 2*MVK_FRAMES_IN_FLIGHT) {
@@ -1411,7 +1116,7 @@ int main() {
 			mvk->image_available_sems = sems;
 			mvk->render_finished_sems = &sems[MVK_FRAMES_IN_FLIGHT];
 
-			mvk->in_flight_fences = mam_stack_pusht(VkFence, mvk->stack, MVK_FRAMES_IN_FLIGHT);
+			mvk->in_flight_fences = vstack_pusht(VkFence, mvk->stack, MVK_FRAMES_IN_FLIGHT);
 			VkFenceCreateInfo fence_info = {};
 			fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 			fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -1441,6 +1146,20 @@ int main() {
 			if(vkCreateShaderModule(mvk->device, &shader_vert_mod_info, 0, &shader_vert) != VK_SUCCESS) {
 				MAM_ERRORL("Failed to create the vulkan fragment shader\n");
 			}
+			//the boards shader is optional, without it walls are drawn square by square through the main pipeline
+			VkShaderModule shader_boards_vert = {};
+			SDL_RWops* boards_vert_file = SDL_RWFromFile(MVK_SHADER_BOARDS_VERT, "r");
+			if(boards_vert_file) {
+				SDL_RWclose(boards_vert_file);
+				VkShaderModuleCreateInfo shader_boards_vert_mod_info = {};
+				MamString boards_vert_code = read_file_to_stack(MVK_SHADER_BOARDS_VERT, mvk->stack);
+				shader_boards_vert_mod_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+				shader_boards_vert_mod_info.codeSize = boards_vert_code.size;
+				shader_boards_vert_mod_info.pCode = (uint32*)boards_vert_code.ptr;
+				if(vkCreateShaderModule(mvk->device, &shader_boards_vert_mod_info, 0, &shader_boards_vert) != VK_SUCCESS) {
+					MAM_ERRORL("Failed to create the vulkan boards vertex shader\n");
+				}
+			}
 
 			VkPipelineShaderStageCreateInfo shader_frag_info = {};
 			shader_frag_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1456,30 +1175,25 @@ int main() {
 			shader_vert_info.pName = "main";
 			shader_vert_info.pSpecializationInfo = 0;//can use this for compile time constants
 
-			mvk->shader_stages = mam_stack_pusht(VkPipelineShaderStageCreateInfo, mvk->stack, 2);
+			VkPipelineShaderStageCreateInfo shader_boards_vert_info = shader_vert_info;
+			shader_boards_vert_info.module = shader_boards_vert;
+
+			//the first 2 stages make the main pipeline, the boards pipeline swaps in the last one as its vertex shader
+			mvk->shader_stages = vstack_pusht(VkPipelineShaderStageCreateInfo, mvk->stack, 3);
 			mvk->shader_stages[0] = shader_vert_info;
 			mvk->shader_stages[1] = shader_frag_info;
-			mvk->shader_stages_size = 2;
+			mvk->shader_stages[2] = shader_boards_vert_info;
+			mvk->shader_stages_size = boards_vert_file ? 3 : 2;
 		}
 		{//create command pool
 			VkCommandPoolCreateInfo command_pool_info = {};
 			command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 			command_pool_info.queueFamilyIndex = mvk->draw_queue_i;
-			command_pool_info.flags = 0; // Optional
+			command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;//command buffers are re-recorded every frame
 			if(vkCreateCommandPool(mvk->device, &command_pool_info, 0, &mvk->command_pool) != VK_SUCCESS) {
 				ERRORL("Failed to create a vulkan command pool\n");
 			}
 		}
-		{//create vertex buffer
-			mvk->vertex_buffer_size = VERTEX_BUFFER_SIZE;
-
-			create_buffer(mvk, sizeof(Vertex)*mvk->vertex_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mvk->vertex_buffer, &mvk->vertex_buffer_memory);
-		}
-		{//create index buffer
-			mvk->index_buffer_size = INDEX_BUFFER_SIZE;
-
-			create_buffer(mvk, sizeof(int32)*mvk->index_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mvk->index_buffer, &mvk->index_buffer_memory);
-		}
 		{//create descriptor set layout
 			VkDescriptorSetLayoutBinding ubo_layout_binding = {};
 			ubo_layout_binding.binding = 0;
@@ -1497,11 +1211,91 @@ int main() {
 				ERRORL("Failed to create a vulkan descriptor set layout");
 			}
 		}
+		{//create per frame resources
+			mvk->vertex_buffer_size = VERTEX_BUFFER_SIZE;
+			mvk->index_buffer_size = INDEX_BUFFER_SIZE;
+			mvk->instance_buffer_size = INSTANCE_BUFFER_SIZE;
+			mvk->frames = vstack_pusht(MvkFrame, mvk->stack, MVK_FRAMES_IN_FLIGHT);
+			memzero(mvk->frames, MVK_FRAMES_IN_FLIGHT);
+
+			VkCommandBuffer command_buffers[MVK_FRAMES_IN_FLIGHT];
+			VkCommandBufferAllocateInfo command_alloc_info = {};
+			command_alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			command_alloc_info.commandPool = mvk->command_pool;
+			command_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			command_alloc_info.commandBufferCount = MVK_FRAMES_IN_FLIGHT;
+			if(vkAllocateCommandBuffers(mvk->device, &command_alloc_info, command_buffers) != VK_SUCCESS) {
+				ERRORL("Failed to allocate vulkan command buffers");
+			}
+
+			VkDescriptorPoolSize pool_size_info = {};
+			pool_size_info.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			pool_size_info.descriptorCount = MVK_FRAMES_IN_FLIGHT;
+
+			VkDescriptorPoolCreateInfo pool_info = {};
+			pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+			pool_info.poolSizeCount = 1;
+			pool_info.pPoolSizes = &pool_size_info;
+			pool_info.maxSets = MVK_FRAMES_IN_FLIGHT;
+
+			if(vkCreateDescriptorPool(mvk->device, &pool_info, 0, &mvk->descriptor_pool) != VK_SUCCESS) {
+				ERRORL("Failed to create a vulkan descriptor pool\n");
+			}
+
+			VkDescriptorSetLayout layouts[MVK_FRAMES_IN_FLIGHT];
+			for_each_in(VkDescriptorSetLayout, layout, layouts, MVK_FRAMES_IN_FLIGHT) *layout = mvk->descriptor_set_layout;
+			VkDescriptorSet descriptor_sets[MVK_FRAMES_IN_FLIGHT];
+
+			VkDescriptorSetAllocateInfo descriptor_alloc_info = {};
+			descriptor_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			descriptor_alloc_info.descriptorPool = mvk->descriptor_pool;
+			descriptor_alloc_info.descriptorSetCount = MVK_FRAMES_IN_FLIGHT;
+			descriptor_alloc_info.pSetLayouts = layouts;
+			if(vkAllocateDescriptorSets(mvk->device, &descriptor_alloc_info, descriptor_sets) != VK_SUCCESS) {
+				ERRORL("Failed to allocate vulkan descriptor sets\n");
+			}
+
+			for_each_index(MvkFrame, i, frame, mvk->frames, MVK_FRAMES_IN_FLIGHT) {
+				frame->command_buffer = command_buffers[i];
+				frame->descriptor_set = descriptor_sets[i];
+				//geometry is rewritten every frame, so it lives in host visible memory instead of being staged to device local memory
+				VkMemoryPropertyFlags host_memory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+				create_buffer(mvk, mvk->vertex_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, host_memory, &frame->vertex_buffer, &frame->vertex_buffer_memory);
+				create_buffer(mvk, mvk->index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, host_memory, &frame->index_buffer, &frame->index_buffer_memory);
+				create_buffer(mvk, sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, host_memory, &frame->uniform_buffer, &frame->uniform_buffer_memory);
+				vkMapMemory(mvk->device, frame->vertex_buffer_memory, 0, mvk->vertex_buffer_size, 0, (void**)&frame->vertices);
+				vkMapMemory(mvk->device, frame->index_buffer_memory, 0, mvk->index_buffer_size, 0, (void**)&frame->indices);
+				create_buffer(mvk, mvk->instance_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, host_memory, &frame->instance_buffer, &frame->instance_buffer_memory);
+				vkMapMemory(mvk->device, frame->uniform_buffer_memory, 0, sizeof(UniformBufferObject), 0, (void**)&frame->uniform);
+				vkMapMemory(mvk->device, frame->instance_buffer_memory, 0, mvk->instance_buffer_size, 0, (void**)&frame->instances);
+				frame->indices_size = 0;
+				frame->instances_size = 0;
+
+				VkDescriptorBufferInfo buffer_info = {};
+				buffer_info.buffer = frame->uniform_buffer;
+				buffer_info.offset = 0;
+				buffer_info.range = sizeof(UniformBufferObject);
+
+				VkWriteDescriptorSet descriptor_write = {};
+				descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptor_write.dstSet = frame->descriptor_set;
+				descriptor_write.dstBinding = 0;
+				descriptor_write.dstArrayElement = 0;
+				descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				descriptor_write.descriptorCount = 1;
+				descriptor_write.pBufferInfo = &buffer_info;
+				descriptor_write.pImageInfo = 0; // Optional
+				descriptor_write.pTexelBufferView = 0; // Optional
+
+				vkUpdateDescriptorSets(mvk->device, 1, &descriptor_write, 0, 0);
+			}
+		}
 		find_device_capabilities(mvk, window);
 		create_swap_chain(mvk);
 		create_pipeline(mvk);
 	}
 
+	double time_per_frame = pacing_time_per_frame(&pacing);
 	int64 counts_per_frame = cast(int64, gb_floor(time_per_frame*SDL_GetPerformanceFrequency()));
 
 	uint64 frame_boundary = SDL_GetPerformanceCounter();
@@ -1510,22 +1304,186 @@ int main() {
 	double lifetime = 0;
 	int64 dropped_frames = 0;
 
-	trash.game_desc = game_new();
+	if(load_filename && game_load(load_filename, &trash.game_desc)) {
+		grid_w = cast(Game*, trash.game_desc.mem)->grid_w;
+		grid_h = cast(Game*, trash.game_desc.mem)->grid_h;
+		if(record_filename) {
+			//a replay only holds the seed and the inputs, it can't start from a loaded game
+			printf("Not recording a replay of a loaded game\n");
+			record_filename = 0;
+		}
+	} else {
+		trash.game_desc = game_new(seed, grid_w, grid_h);
+	}
 	Game* game = (Game*)trash.game_desc.mem;
+	if(wall_size > 0) {
+		game_set_wall(game, wall_size, seed);
+		if(record_filename) {
+			printf("Not recording a replay of a wall\n");
+			record_filename = 0;
+		}
+	}
+	if(!game_uses_board(game)) printf("%dx%d grid on %s, move kernel: %s\n", game->grid_w, game->grid_h, game_mem_backing_name(&game->grid_desc), grid_slide_line_name);
+
+	ReplayRecorder* recorder = malloct(ReplayRecorder, 1);
+	trash.ptrs[1] = recorder;
+	recorder->file = 0;
+	if(record_filename) replay_record_begin(recorder, record_filename, seed, grid_w, grid_h);
+	SDL_Event* events = vstack_pusht(SDL_Event, mvk->stack, EVENTS_PER_FRAME_MAX);
+
+	JobPool* jobs = malloct(JobPool, 1);
+	trash.ptrs[2] = jobs;
+	jobs_init(jobs, SDL_GetCPUCount() - 1);
+	trash.jobs = jobs;
+	Solver* solver = solver_new(jobs, SOLVER_TABLE_SIZE_LOG2);
+	trash.solver = solver;
+	printf("Solver table: %dMB on %s\n", cast(int32, ((solver->table_mask + 1)*sizeof(SolverEntry))/MEGABYTE), huge_backing_name(solver->table_backing));
+	MonteCarlo* montecarlo = malloct(MonteCarlo, 1);
+	montecarlo_init(montecarlo, jobs, seed);
+	trash.montecarlo = montecarlo;
+	int32 autoplay_move = MOVE_NONE;
+	Tablebase tablebase = {};
+	int32 tablebase_w = 0;//shape of the grid tablebase was last looked for, a missing file is only looked for once
+	int32 tablebase_h = 0;
+	Ntuple ntuple;
+	if(ntuple_map(&ntuple, NTUPLE_FILENAME, 0)) {
+		printf("n-tuple network %s trained on %llu games\n", NTUPLE_FILENAME, cast(unsigned long long, ntuple.header->games));
+	}
+	GameModule module;
+	game_module_init(&module);
 
 	while(1) {
+		int32 frame_i = lifetime_frames%MVK_FRAMES_IN_FLIGHT;
+		#if GAME_HOT_RELOAD
+		//swapping the game's code is only safe here, where none of it is running
+		game_module_reload(&module, GAME_MODULE_FILENAME, main_trap, &trash);
+		#endif
+		#if !PEDAL_TO_THE_METAL
+		if(mvk->device_does_vsync && pacing.wake_delay > 0) {
+			//start the frame as late as we can while still making the next vsync
+			wait_until(frame_boundary + cast(uint64, pacing.wake_delay*SDL_GetPerformanceFrequency()));
+		}
+		#endif
+		//wait for the gpu to free up this frame before polling input, so the input we act on is as fresh as possible by the time we record
+		//any time spent blocked on the gpu or the display is slack the frame could have started later by
+		uint64 block_start = SDL_GetPerformanceCounter();
+		vkWaitForFences(mvk->device, 1, &mvk->in_flight_fences[frame_i], VK_TRUE, UINT64_MAX);
+		double time_blocked = get_delta_time(block_start, SDL_GetPerformanceCounter());
+
 		//update game
 		double delta = min(frame_duration, MAX_UPDATE_DELTA);
-		Output output = game_update(game, delta);
+		int32 events_size = poll_events(events, EVENTS_PER_FRAME_MAX);
+		if(autoplay_move != MOVE_NONE) {
+			events_size += push_move_events(events + events_size, EVENTS_PER_FRAME_MAX - events_size, autoplay_move);
+			autoplay_move = MOVE_NONE;
+		}
+		if(recorder->file) {
+			delta = replay_quantize_delta(delta);
+			replay_record_frame(recorder, lifetime_frames, events, events_size, game, delta);
+		}
+		Output output = module.api.update(game, events, events_size, delta);
 
 		if(output.game_quit) break;
+		if(output.save_game) {
+			if(save_to_file(&trash.game_desc, SAVE_QUICK_FILENAME)) printf("Saved to %s\n", SAVE_QUICK_FILENAME);
+		}
+		if(output.load_game) {
+			GameMemDesc game_desc;
+			if(recorder->file) {
+				printf("Can't load a game while recording a replay\n");
+			} else if(game_load(SAVE_QUICK_FILENAME, &game_desc)) {
+				game_free_recursively(&trash.game_desc);
+				trash.game_desc = game_desc;
+				game = (Game*)trash.game_desc.mem;
+				game->do_draw = 1;
+				autoplay_move = MOVE_NONE;
+				output.search_move = 0;
+				output.input_timestamp = 0;
+			}
+		}
+		if(output.search_move) {
+			if(!game_uses_board(game)) {
+				//small grids were solved ahead of time by the tablebase tool, their hints are a lookup in the file it wrote
+				if(tablebase_w != game->grid_w || tablebase_h != game->grid_h) {
+					tablebase_unmap(&tablebase);
+					tablebase_w = game->grid_w;
+					tablebase_h = game->grid_h;
+					char tablebase_filename[64];
+					snprintf(tablebase_filename, 64, TABLEBASE_FILENAME_FORMAT, tablebase_w, tablebase_h);
+					if(tablebase_map(&tablebase, tablebase_filename)) {
+						if(tablebase.shape.w != tablebase_w || tablebase.shape.h != tablebase_h) {
+							printf("Invalid tablebase file: %s\n", tablebase_filename);
+							tablebase_unmap(&tablebase);
+						}
+					} else {
+						printf("No tablebase for %dx%d grids, the tablebase tool can make %s\n", tablebase_w, tablebase_h, tablebase_filename);
+					}
+				}
+				TablebaseKey key;
+				int64 state_i = -1;
+				if(tablebase.header && tablebase_pack(game->grid, game->grid_w, game->grid_h, &key)) state_i = tablebase_find(&tablebase, key);
+				game->hint_move = (state_i >= 0) ? tablebase.moves[state_i] : MOVE_NONE;
+				if(!game->autoplay && state_i >= 0) {
+					printf("hint: move %d, expected score still to come %.0f (tablebase)\n", game->hint_move, tablebase.values[state_i]);
+				}
+			} else if(game->autoplayer == AUTOPLAYER_NTUPLE && ntuple.header) {
+				//without a trained network the n-tuple autoplayer falls back to the solver
+				game->hint_move = ntuple_best_move(&ntuple, game->board, 0, 0);
+				if(!game->autoplay) {
+					Board moved = board_move(game->board, game->hint_move);
+					printf("hint: move %d, expected score still to come %.0f (n-tuple network)\n", game->hint_move, board_move_score(game->board, game->hint_move) + ntuple_value(&ntuple, moved));
+				}
+			} else if(game->autoplayer == AUTOPLAYER_MONTECARLO) {
+				//the two share the job pool, and the solver may still be on a search from before the autoplayer changed
+				solver_cancel(solver);
+				//a search of a board that is gone would keep the new one from starting and then be thrown away below
+				if(montecarlo->search_board != game->board) montecarlo_cancel(montecarlo);
+				//plays out on its own thread, its answer is picked up below once it's done
+				montecarlo_start(montecarlo, game->board, MONTECARLO_ROLLOUTS_MIN, MONTECARLO_TIME_BUDGET);
+			} else {
+				montecarlo_cancel(montecarlo);
+				if(solver->search_board != game->board) solver_cancel(solver);
+				//searches on the solver's thread, its answer is picked up below once it's done
+				solver_start(solver, game->board, SOLVER_TIME_BUDGET);
+			}
+			if(game->autoplay) autoplay_move = game->hint_move;
+		}
+		{//pick up the answers of the searches that run on their own threads
+			//the game may have moved on while they searched, then the answer is for a board that is gone
+			bool is_searched_board = game_uses_board(game) && game->state == GAME_STATE_2048;
+			SolverResult result;
+			if(solver_poll(solver, &result) && is_searched_board && game->board == solver->search_board) {
+				game->hint_move = result.move;
+				if(game->autoplay) {
+					autoplay_move = game->hint_move;
+				} else {
+					printf("hint: move %d, depth %d, %lld nodes in %.2fms\n", result.move, result.depth, cast(long long, result.nodes), 1000*result.time);
+				}
+			}
+			MonteCarloResult montecarlo_result;
+			if(montecarlo_poll(montecarlo, &montecarlo_result) && is_searched_board && game->board == montecarlo->search_board) {
+				game->hint_move = montecarlo_result.move;
+				if(game->autoplay) {
+					autoplay_move = game->hint_move;
+				} else {
+					printf("hint: move %d, mean score %.0f, %lld rollouts in %.2fms (%.0f rollouts per second)\n", montecarlo_result.move, montecarlo_result.mean_score, cast(long long, montecarlo_result.rollouts), 1000*montecarlo_result.time, montecarlo_result.rollouts_per_second);
+				}
+			}
+		}
+		{//check if the window moved to a different monitor
+			int display_index = SDL_GetWindowDisplayIndex(window);
+			if(display_index >= 0 && display_index != pacing.display_index) output.display_change = 1;
+			if(output.display_change) {
+				pacing_reset(&pacing, display_index >= 0 ? display_index : pacing.display_index);
+				//the new monitor may support different present modes
+				output.window_resize = 1;
+			}
+		}
 		if(output.window_resize) recreate_swap_chain(mvk, window);
 		if(output.do_draw) {//draw then present frame
-			int32 frame_i = lifetime_frames%MVK_FRAMES_IN_FLIGHT;
 			uint32 image_i = 0;
 
-			vkWaitForFences(mvk->device, 1, &mvk->in_flight_fences[frame_i], VK_TRUE, UINT64_MAX);
-
+			block_start = SDL_GetPerformanceCounter();
 			VkResult result = vkAcquireNextImageKHR(mvk->device, mvk->swap_chain, MAX_UINT64, mvk->image_available_sems[frame_i], VK_NULL_HANDLE, &image_i);
 			if(result != VK_ERROR_OUT_OF_DATE_KHR && result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 				ERRORL("Failed to acquire a vulkan swap chain image");
@@ -1535,13 +1493,15 @@ int main() {
 			if(mvk->images_in_flight_fences[image_i] != VK_NULL_HANDLE) {
 				vkWaitForFences(mvk->device, 1, &mvk->images_in_flight_fences[image_i], VK_TRUE, MAX_UINT64);
 			}
+			time_blocked += get_delta_time(block_start, SDL_GetPerformanceCounter());
 			// Mark the image as now being in use by this frame
 			mvk->images_in_flight_fences[image_i] = mvk->in_flight_fences[frame_i];
 
 			vkResetFences(mvk->device, 1, &mvk->in_flight_fences[frame_i]);
 
 			//render the frame
-			game_render(game, delta, mvk, image_i);
+			module.api.render(game, delta, mvk, frame_i);
+			record_command_buffer(mvk, frame_i, image_i);
 
 
 			VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -1551,7 +1511,7 @@ int main() {
 			submit_info.pWaitSemaphores = &mvk->image_available_sems[frame_i];
 			submit_info.pWaitDstStageMask = &wait_stage;
 			submit_info.commandBufferCount = 1;
-			submit_info.pCommandBuffers = &mvk->command_buffers[image_i];
+			submit_info.pCommandBuffers = &mvk->frames[frame_i].command_buffer;
 			submit_info.signalSemaphoreCount = 1;
 			submit_info.pSignalSemaphores = &mvk->render_finished_sems[frame_i];
 			auto temp = vkQueueSubmit(mvk->draw_queue, 1, &submit_info, mvk->in_flight_fences[frame_i]);
@@ -1567,13 +1527,44 @@ int main() {
 			present_info.pSwapchains = &mvk->swap_chain;
 			present_info.pImageIndices = &image_i;
 			present_info.pResults = 0; // Optional
+			VkPresentTimeGOOGLE present_time = {};
+			VkPresentTimesInfoGOOGLE present_times_info = {};
+			if(mvk->has_display_timing) {
+				mvk->present_id += 1;
+				present_time.presentID = mvk->present_id;
+				present_time.desiredPresentTime = 0;//as soon as possible
+				present_times_info.sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE;
+				present_times_info.swapchainCount = 1;
+				present_times_info.pTimes = &present_time;
+				present_info.pNext = &present_times_info;
+			}
+			block_start = SDL_GetPerformanceCounter();
 			result = vkQueuePresentKHR(mvk->present_queue, &present_info);
 			if(result != VK_ERROR_OUT_OF_DATE_KHR && result != VK_SUBOPTIMAL_KHR && result != VK_SUCCESS) {
 				ERRORL("Failed to present a vulkan swap chain image");
 			}
+			uint64 present_return = SDL_GetPerformanceCounter();
+			time_blocked += get_delta_time(block_start, present_return);
+			if(output.input_timestamp) latency_record(&latency, output.input_timestamp, SDL_GetTicks());
+			if(mvk->device_does_vsync) {
+				if(!(mvk->has_display_timing && pacing_poll_display_timing(&pacing, mvk))) {
+					//software fallback for when the driver can't tell us when frames were displayed (e.g. lavapipe): estimate from how long we were blocked on fences, acquire and present
+					double interval = pacing_record_present(&pacing, present_return);
+					bool missed_vsync = interval > PRESENT_MISSED_RATIO*pacing_time_per_frame(&pacing);
+					pacing_update_wake_delay(&pacing, time_blocked, missed_vsync);
+				}
+			} else {
+				pacing.last_present = 0;
+				pacing.wake_delay = 0;
+			}
+		} else {
+			pacing.last_present = 0;
 		}
 
 		{//control framerate
+			time_per_frame = pacing_time_per_frame(&pacing);
+			counts_per_frame = cast(int64, gb_floor(time_per_frame*SDL_GetPerformanceFrequency()));
+
 			uint64 compute_boundary = SDL_GetPerformanceCounter();
 			double time_to_compute = get_delta_time(frame_boundary, compute_boundary);
 			uint64 new_frame_boundary = compute_boundary;
@@ -1582,6 +1573,9 @@ int main() {
 			if(lifetime_frames%FPS_PRINTOUT_FREQUENCY == 1) {
 				// printf("compute time: %2.2fHz\n", 1/time_to_compute);
 				printf("frame duration: %2.2fHz\n", 1/frame_duration);
+				printf("refresh rate: %2.2fHz\n", 1/time_per_frame);
+				printf("frame start delay: %.2fms (%s)\n", 1000*pacing.wake_delay, mvk->has_display_timing ? "display timing" : "fence estimate");
+				latency_print(&latency);
 				// printf("dropped frames: %d\n", dropped_frames);
 			}
 			#endif
@@ -1589,14 +1583,7 @@ int main() {
 			#if !PEDAL_TO_THE_METAL
 			if(!mvk->device_does_vsync || !output.do_draw) {//vsync does not work when nothing is drawing
 				if(time_to_compute < time_per_frame) {
-					double time_to_wait = time_per_frame - time_to_compute - DELAY_RESOLUTION;
-					if(time_to_wait > 0) {
-						SDL_Delay(cast(uint32, 1000.0*time_to_wait));
-					}
-					new_frame_boundary = SDL_GetPerformanceCounter();
-					while((new_frame_boundary - frame_boundary) < counts_per_frame) {
-						new_frame_boundary = SDL_GetPerformanceCounter();
-					}
+					new_frame_boundary = wait_until(frame_boundary + counts_per_frame);
 				} else {
 					dropped_frames += 1;
 				}
@@ -1606,9 +1593,25 @@ int main() {
 			frame_boundary = new_frame_boundary;
 			lifetime += frame_duration;
 			lifetime_frames += 1;
+			#ifdef MEMPROF
+			//the temp stack is reallocated whenever a game is loaded
+			memprof_track_stack(game->temp_stack, "game temp");
+			memprof_frame();
+			#endif
 		}
 	}
+	#ifdef MEMPROF
+	memprof_report();
+	#endif
 
+	replay_record_end(recorder);
+	if(game->wall->size > 0) {
+		Wall* wall = game->wall;
+		printf("wall of %d boards: %lld moves, %lld games finished, best score %u, best tile %d\n", wall->size, cast(long long, wall->moves), cast(long long, wall->games), wall->best_score, (wall->best_exponent > 0) ? 1 << wall->best_exponent : 0);
+	}
 	main_cleanup(&trash);
+	tablebase_unmap(&tablebase);
+	ntuple_unmap(&ntuple);
+	game_module_unload(&module);
 	return 0;
 }
@@ -0,0 +1,380 @@
+// An allocation profiler, built in with -D MEMPROF and nothing at all
+// without it. It replaces mamlib's mam_gen_ macros, which every allocation
+// through a MamAllocatorFunc goes through, malloc and free included, with
+// ones that also log the call site, allocator, size and frame of the
+// allocation. So it has to be included before anything that allocates, and
+// wrappers that should be blamed on their callers have to be macros too.
+// A thread only appends to a buffer of its own, memprof_frame folds every
+// buffer into per site totals once a frame and memprof_report prints them:
+// the peak bytes each site had live at once, how many times it allocated in
+// its busiest frame, and how many frames its blocks lived on average. Every
+// stack passed to memprof_track_stack also gets its highest_size reported.
+//
+// Pushes through a stack allocator are counted but never live, stacks are
+// mostly popped by setting their size, which logs nothing, so their peak is
+// the most bytes pushed in one frame instead. A block freed on one thread before
+// the thread that allocated it had its buffer folded is missed, the tables
+// are fixed size and only report what they had to drop. Allocations made in
+// the game module aren't logged, the module has its own copy of mamlib.
+
+#ifdef MEMPROF
+const int MEMPROF_THREADS_MAX = 64;
+const int MEMPROF_EVENTS_MAX = 4096;// per thread, a full buffer is folded by its own thread
+const int MEMPROF_SITES_MAX = 4096;// power of 2
+const int MEMPROF_LIVE_MAX = 1 << 20;// power of 2
+const int MEMPROF_STACKS_MAX = 32;
+const int MEMPROF_NAMES_MAX = 16;
+const int MEMPROF_REPORT_SITES = 40;
+
+typedef struct MemprofEvent {
+	const char* file;
+	int32 line;
+	int32 mode;// a MamAllocMode
+	MamAllocatorFunc* allocator;
+	void* allocator_data;
+	void* old_ptr;
+	void* ptr;
+	inta size;
+} MemprofEvent;
+
+typedef struct MemprofBuffer {
+	thread_mutex_t lock;
+	int32 size;
+	MemprofEvent events[MEMPROF_EVENTS_MAX];
+} MemprofBuffer;
+
+typedef struct MemprofSite {
+	//file is 0 for an unused slot
+	const char* file;
+	int32 line;
+	MamAllocatorFunc* allocator;
+	bool is_stack;
+	int64 allocs;
+	int64 bytes;// allocated in total
+	inta live_bytes;
+	inta peak_bytes;
+	int64 frame_allocs;
+	inta frame_bytes;
+	int64 peak_frame_allocs;
+	int64 lifetime_frames;// summed over every block freed
+	int64 frees;
+} MemprofSite;
+
+typedef struct MemprofLive {
+	//ptr is 0 for an unused slot
+	void* ptr;
+	void* allocator_data;
+	inta size;
+	int32 site_i;
+	int32 frame;
+} MemprofLive;
+
+typedef struct MemprofStack {
+	MamStack* stack;
+	const char* name;
+} MemprofStack;
+
+typedef struct MemprofName {
+	MamAllocatorFunc* allocator;
+	const char* name;
+	bool is_stack;
+} MemprofName;
+
+static bool memprof__is_init;
+static thread_tls_t memprof__tls;
+static thread_mutex_t memprof__lock;// of everything below, buffers are locked after it
+static MemprofBuffer memprof__buffers[MEMPROF_THREADS_MAX];
+static thread_atomic_int_t memprof__buffers_size;
+static MemprofSite memprof__sites[MEMPROF_SITES_MAX];
+static MemprofLive memprof__live[MEMPROF_LIVE_MAX];
+static int32 memprof__live_size;
+static MemprofStack memprof__stacks[MEMPROF_STACKS_MAX];
+static int32 memprof__stacks_size;
+static MemprofName memprof__names[MEMPROF_NAMES_MAX];
+static int32 memprof__names_size;
+static int32 memprof__frame;
+static int64 memprof__dropped;
+
+
+void memprof_init() {
+	//must be called before any allocation that should be logged, allocations before it are let through
+	memprof__tls = thread_tls_create();
+	thread_mutex_init(&memprof__lock);
+	memprof__is_init = 1;
+}
+
+static inline uint32 memprof__hash(uint64 key) {
+	key *= 0x9e3779b97f4a7c15ull;
+	return cast(uint32, key >> 32);
+}
+
+static int32 memprof__site(MemprofEvent* event) {
+	uint32 mask = MEMPROF_SITES_MAX - 1;
+	uint32 i = memprof__hash(cast(uintptr_t, event->file) ^ (cast(uint64, event->line) << 40) ^ cast(uintptr_t, event->allocator)) & mask;
+	for_each_lt(probe, MEMPROF_SITES_MAX) {
+		MemprofSite* site = &memprof__sites[i];
+		if(!site->file) {
+			site->file = event->file;
+			site->line = event->line;
+			site->allocator = event->allocator;
+			for_each_lt(n, memprof__names_size) site->is_stack |= memprof__names[n].is_stack && memprof__names[n].allocator == event->allocator;
+			return i;
+		}
+		if(site->file == event->file && site->line == event->line && site->allocator == event->allocator) return i;
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+static MemprofLive* memprof__live_find(void* ptr) {
+	uint32 mask = MEMPROF_LIVE_MAX - 1;
+	uint32 i = memprof__hash(cast(uintptr_t, ptr)) & mask;
+	while(memprof__live[i].ptr) {
+		if(memprof__live[i].ptr == ptr) return &memprof__live[i];
+		i = (i + 1) & mask;
+	}
+	return &memprof__live[i];
+}
+static void memprof__live_remove(MemprofLive* entry) {
+	//moves later entries of the probe chain back into the hole, so the chain never needs tombstones
+	uint32 mask = MEMPROF_LIVE_MAX - 1;
+	uint32 hole = cast(uint32, entry - memprof__live);
+	uint32 i = hole;
+	while(1) {
+		memprof__live[hole].ptr = 0;
+		while(1) {
+			i = (i + 1) & mask;
+			if(!memprof__live[i].ptr) return;
+			uint32 home = memprof__hash(cast(uintptr_t, memprof__live[i].ptr)) & mask;
+			//an entry can only move back if its home isn't between the hole and where it is now
+			bool can_move = (hole <= i) ? (home <= hole || home > i) : (home <= hole && home > i);
+			if(can_move) break;
+		}
+		memprof__live[hole] = memprof__live[i];
+		hole = i;
+	}
+}
+
+static void memprof__free(void* ptr) {
+	if(!ptr) return;
+	MemprofLive* entry = memprof__live_find(ptr);
+	if(!entry->ptr) return;
+	MemprofSite* site = &memprof__sites[entry->site_i];
+	site->live_bytes -= entry->size;
+	site->frees += 1;
+	site->lifetime_frames += memprof__frame - entry->frame;
+	memprof__live_remove(entry);
+	memprof__live_size -= 1;
+}
+static void memprof__alloc(MemprofEvent* event) {
+	int32 site_i = memprof__site(event);
+	if(site_i < 0) {
+		memprof__dropped += 1;
+		return;
+	}
+	MemprofSite* site = &memprof__sites[site_i];
+	site->allocs += 1;
+	site->bytes += event->size;
+	site->frame_allocs += 1;
+	site->frame_bytes += event->size;
+	if(site->is_stack) {
+		if(site->peak_bytes < site->frame_bytes) site->peak_bytes = site->frame_bytes;
+		return;
+	}
+	if(!event->ptr) return;
+	MemprofLive* entry = memprof__live_find(event->ptr);
+	if(entry->ptr) {
+		//the block's free was missed, it was given out again so it must have been freed
+		memprof__free(event->ptr);
+		entry = memprof__live_find(event->ptr);
+	}
+	if(memprof__live_size >= MEMPROF_LIVE_MAX/2) {
+		memprof__dropped += 1;
+		return;
+	}
+	entry->ptr = event->ptr;
+	entry->allocator_data = event->allocator_data;
+	entry->size = event->size;
+	entry->site_i = site_i;
+	entry->frame = memprof__frame;
+	memprof__live_size += 1;
+	site->live_bytes += event->size;
+	if(site->peak_bytes < site->live_bytes) site->peak_bytes = site->live_bytes;
+}
+static void memprof__freeall(MemprofEvent* event) {
+	//everything live from the allocator and its data goes, which takes a walk over the whole table
+	//the system allocator's data is 0 and it ignores a freeall, so one with no data is ignored here too
+	if(!event->allocator_data) return;
+	for_each_lt(i, MEMPROF_LIVE_MAX) {
+		MemprofLive* entry = &memprof__live[i];
+		while(entry->ptr && entry->allocator_data == event->allocator_data && memprof__sites[entry->site_i].allocator == event->allocator) {
+			//removing an entry can move another one into its slot
+			memprof__free(entry->ptr);
+		}
+	}
+}
+
+static void memprof__fold(MemprofBuffer* buffer) {
+	//memprof__lock and the buffer's lock have to be held
+	for_each_lt(i, buffer->size) {
+		MemprofEvent* event = &buffer->events[i];
+		if(event->mode == MAM_MODE_ALLOC) {
+			memprof__alloc(event);
+		} else if(event->mode == MAM_MODE_REALLOC) {
+			memprof__free(event->old_ptr);
+			if(event->size) memprof__alloc(event);
+		} else if(event->mode == MAM_MODE_FREE) {
+			memprof__free(event->old_ptr);
+		} else if(event->mode == MAM_MODE_FREEALL) {
+			memprof__freeall(event);
+		}
+	}
+	buffer->size = 0;
+}
+static void memprof__fold_all() {
+	//memprof__lock has to be held
+	int32 buffers_size = thread_atomic_int_load(&memprof__buffers_size);
+	if(buffers_size > MEMPROF_THREADS_MAX) buffers_size = MEMPROF_THREADS_MAX;
+	for_each_lt(i, buffers_size) {
+		MemprofBuffer* buffer = &memprof__buffers[i];
+		thread_mutex_lock(&buffer->lock);
+		memprof__fold(buffer);
+		thread_mutex_unlock(&buffer->lock);
+	}
+}
+
+static MemprofBuffer* memprof__buffer() {
+	MemprofBuffer* buffer = cast(MemprofBuffer*, thread_tls_get(memprof__tls));
+	if(!buffer) {
+		int32 i = thread_atomic_int_inc(&memprof__buffers_size);
+		if(i >= MEMPROF_THREADS_MAX) {
+			MAM_ERRORL("Too many threads allocated while profiling");
+		}
+		buffer = &memprof__buffers[i];
+		thread_mutex_init(&buffer->lock);
+		buffer->size = 0;
+		thread_tls_set(memprof__tls, buffer);
+	}
+	return buffer;
+}
+
+void* memprof__gen(MamAllocMode mode, MamAllocatorFunc* allocator, void* allocator_data, mam_int alloc_size, void* old_ptr, const char* file, int32 line) {
+	void* ptr = allocator(mode, alloc_size, old_ptr, allocator_data);
+	if(!memprof__is_init) return ptr;
+	MemprofBuffer* buffer = memprof__buffer();
+	if(buffer->size == MEMPROF_EVENTS_MAX) {
+		thread_mutex_lock(&memprof__lock);
+		thread_mutex_lock(&buffer->lock);
+		memprof__fold(buffer);
+		thread_mutex_unlock(&buffer->lock);
+		thread_mutex_unlock(&memprof__lock);
+	}
+	thread_mutex_lock(&buffer->lock);
+	MemprofEvent* event = &buffer->events[buffer->size];
+	event->file = file;
+	event->line = line;
+	event->mode = mode;
+	event->allocator = allocator;
+	event->allocator_data = allocator_data;
+	event->old_ptr = old_ptr;
+	event->ptr = ptr;
+	event->size = alloc_size;
+	buffer->size += 1;
+	thread_mutex_unlock(&buffer->lock);
+	return ptr;
+}
+
+void memprof_track_stack(MamStack* stack, const char* name) {
+	//a stack tracked again under the same name replaces the old one, for stacks that get reallocated
+	thread_mutex_lock(&memprof__lock);
+	int32 i = 0;
+	while(i < memprof__stacks_size && strcmp(memprof__stacks[i].name, name) != 0) i += 1;
+	if(i < MEMPROF_STACKS_MAX) {
+		memprof__stacks[i].stack = stack;
+		memprof__stacks[i].name = name;
+		if(i == memprof__stacks_size) memprof__stacks_size += 1;
+	}
+	thread_mutex_unlock(&memprof__lock);
+}
+void memprof_name_allocator(MamAllocatorFunc* allocator, const char* name, bool is_stack) {
+	//names an allocator in the report, pushes through a stack allocator are counted per frame instead of tracked as live
+	//has to be called before the allocator's first allocation
+	if(memprof__names_size < MEMPROF_NAMES_MAX) {
+		memprof__names[memprof__names_size].allocator = allocator;
+		memprof__names[memprof__names_size].name = name;
+		memprof__names[memprof__names_size].is_stack = is_stack;
+		memprof__names_size += 1;
+	}
+}
+static const char* memprof__allocator_name(MamAllocatorFunc* allocator) {
+	for_each_lt(i, memprof__names_size) {
+		if(memprof__names[i].allocator == allocator) return memprof__names[i].name;
+	}
+	return "?";
+}
+
+void memprof_frame() {
+	//call once at the end of every frame
+	thread_mutex_lock(&memprof__lock);
+	memprof__fold_all();
+	for_each_lt(i, MEMPROF_SITES_MAX) {
+		MemprofSite* site = &memprof__sites[i];
+		if(!site->file) continue;
+		if(site->peak_frame_allocs < site->frame_allocs) site->peak_frame_allocs = site->frame_allocs;
+		site->frame_allocs = 0;
+		site->frame_bytes = 0;
+	}
+	memprof__frame += 1;
+	thread_mutex_unlock(&memprof__lock);
+}
+
+void memprof_report() {
+	thread_mutex_lock(&memprof__lock);
+	memprof__fold_all();
+	//sites are ranked by selection, the report is short and only printed once
+	static bool is_printed[MEMPROF_SITES_MAX];
+	memzero(is_printed, MEMPROF_SITES_MAX);
+	int64 allocs = 0;
+	for_each_lt(i, MEMPROF_SITES_MAX) allocs += memprof__sites[i].allocs;
+	printf("memprof: %lld allocations over %d frames, %lld dropped\n", cast(long long, allocs), memprof__frame, cast(long long, memprof__dropped));
+	printf("%10s %10s %8s %10s %10s  %-10s %s\n", "peak KB", "live KB", "allocs", "max/frame", "life", "allocator", "site");
+	for_each_lt(rank, MEMPROF_REPORT_SITES) {
+		int32 best_i = -1;
+		for_each_lt(i, MEMPROF_SITES_MAX) {
+			MemprofSite* site = &memprof__sites[i];
+			if(!site->file || is_printed[i]) continue;
+			if(best_i < 0 || site->peak_bytes > memprof__sites[best_i].peak_bytes) best_i = i;
+		}
+		if(best_i < 0) break;
+		is_printed[best_i] = 1;
+		MemprofSite* site = &memprof__sites[best_i];
+		char life[32];
+		if(site->is_stack) {
+			snprintf(life, sizeof(life), "stack");
+		} else if(site->frees) {
+			snprintf(life, sizeof(life), "%.1f", cast(double, site->lifetime_frames)/site->frees);
+		} else {
+			snprintf(life, sizeof(life), "never freed");
+		}
+		printf("%10.1f %10.1f %8lld %10lld %10s  %-10s %s:%d\n", site->peak_bytes/1024.0, site->live_bytes/1024.0, cast(long long, site->allocs), cast(long long, site->peak_frame_allocs), life, memprof__allocator_name(site->allocator), site->file, site->line);
+	}
+	for_each_lt(i, memprof__stacks_size) {
+		MamStack* stack = memprof__stacks[i].stack;
+		printf("stack %s: %.1fKB used, %.1fKB highest of %.1fKB\n", memprof__stacks[i].name, stack->size/1024.0, stack->highest_size/1024.0, stack->capacity/1024.0);
+	}
+	thread_mutex_unlock(&memprof__lock);
+}
+
+#undef mam_gen_malloc
+#undef mam_gen_malloct
+#undef mam_gen_realloc
+#undef mam_gen_realloct
+#undef mam_gen_free
+#undef mam_gen_freeall
+#define mam_gen_malloc(allocator, allocator_data, alloc_size) memprof__gen(MAM_MODE_ALLOC, allocator, allocator_data, alloc_size, 0, __FILE__, __LINE__)
+#define mam_gen_malloct(type, allocator, allocator_data, alloc_size) ((type*)mam_gen_malloc(allocator, allocator_data, alloc_size))
+#define mam_gen_realloc(allocator, allocator_data, alloc_size, old_ptr) memprof__gen(MAM_MODE_REALLOC, allocator, allocator_data, alloc_size, old_ptr, __FILE__, __LINE__)
+#define mam_gen_realloct(type, allocator, allocator_data, alloc_size, old_ptr) ((type*)mam_gen_realloc(allocator, allocator_data, alloc_size, old_ptr))
+#define mam_gen_free(allocator, allocator_data, old_ptr) memprof__gen(MAM_MODE_FREE, allocator, allocator_data, 0, old_ptr, __FILE__, __LINE__)
+#define mam_gen_freeall(allocator, allocator_data) memprof__gen(MAM_MODE_FREEALL, allocator, allocator_data, 0, 0, __FILE__, __LINE__)
+#endif
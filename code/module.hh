@@ -0,0 +1,105 @@
+// Hot reloading of the game module. The main loop calls game_update and
+// game_render through a GameModule's api, which starts out pointing at the
+// copies linked into the executable. In GAME_HOT_RELOAD builds, whenever
+// GAME_MODULE_FILENAME changes on disk it gets loaded and the api is pointed
+// at its functions in between two frames. The Game memory and all of the
+// Vulkan and SDL state stay as they are, so a change to the game logic shows
+// up as soon as the module is rebuilt instead of after a restart.
+// The module is loaded from a copy of the file, so the build can overwrite
+// the original while it is in use, and if a new module can't be loaded the
+// one that was running is kept.
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+typedef struct GameModule {
+	void* library;// 0 while the game code linked into the executable is in use
+	int64 write_time;// of the file the current library was copied from
+	int32 loads;
+	GameModuleApi api;
+} GameModule;
+
+
+static int64 game_module__write_time(const char* filename) {
+	//0 when there is no such file
+	#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if(!GetFileAttributesExA(filename, GetFileExInfoStandard, &data)) return 0;
+	return (cast(int64, data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+	#else
+	struct stat info;
+	if(stat(filename, &info) != 0) return 0;
+	#ifdef __linux__
+	return cast(int64, info.st_mtim.tv_sec)*1000000000 + info.st_mtim.tv_nsec;
+	#else
+	return cast(int64, info.st_mtime);
+	#endif
+	#endif
+}
+static bool game_module__copy(const char* src_filename, const char* dst_filename) {
+	SDL_RWops* src = SDL_RWFromFile(src_filename, "rb");
+	if(!src) return 0;
+	int64 size = SDL_RWsize(src);
+	byte* buffer = (size > 0) ? malloct(byte, size) : 0;
+	bool is_read = buffer && SDL_RWread(src, buffer, size, 1) == 1;
+	SDL_RWclose(src);
+	SDL_RWops* dst = is_read ? SDL_RWFromFile(dst_filename, "wb") : 0;
+	bool is_written = dst && SDL_RWwrite(dst, buffer, size, 1) == 1;
+	if(dst) SDL_RWclose(dst);
+	free(buffer);
+	return is_written;
+}
+
+void game_module_init(GameModule* module) {
+	memzero(module, 1);
+	module->api.game_size = sizeof(Game);
+	module->api.output_size = sizeof(Output);
+	module->api.mvk_size = sizeof(MvkData);
+	module->api.update = game_update;
+	module->api.render = game_render;
+}
+bool game_module_reload(GameModule* module, const char* filename, MamTrapFunc* trap, void* trap_data) {
+	//loads filename if it changed since it was last loaded, returns whether module's api changed
+	//must be called between frames, the previous library is unloaded right away
+	int64 write_time = game_module__write_time(filename);
+	if(write_time == 0 || write_time == module->write_time) return 0;
+	module->write_time = write_time;
+
+	//the copies alternate, the previous one is still loaded while the next one is written
+	char live_filename[512];
+	snprintf(live_filename, 512, "%s.live%d", filename, module->loads%2);
+	if(!game_module__copy(filename, live_filename)) {
+		printf("Could not copy game module: %s; SDL Error: %s\n", filename, SDL_GetError());
+		return 0;
+	}
+	void* library = SDL_LoadObject(live_filename);
+	if(!library) {
+		//most likely the build hasn't finished writing it, its next write will trigger another try
+		printf("Could not load game module: %s; SDL Error: %s\n", live_filename, SDL_GetError());
+		return 0;
+	}
+	GameModuleLoadFunc* load = (GameModuleLoadFunc*)SDL_LoadFunction(library, "game_module_load");
+	GameModuleApi api = {};
+	if(load) load(&api, trap, trap_data);
+	if(!load || !api.update || !api.render) {
+		printf("Invalid game module: %s\n", filename);
+		SDL_UnloadObject(library);
+		return 0;
+	}
+	if(api.game_size != sizeof(Game) || api.output_size != sizeof(Output) || api.mvk_size != sizeof(MvkData)) {
+		printf("Game module %s was built with a different layout of the game's structs, restart to use it\n", filename);
+		SDL_UnloadObject(library);
+		return 0;
+	}
+	if(module->library) SDL_UnloadObject(module->library);
+	module->library = library;
+	module->api = api;
+	module->loads += 1;
+	printf("Loaded game module %s\n", filename);
+	return 1;
+}
+void game_module_unload(GameModule* module) {
+	if(module->library) SDL_UnloadObject(module->library);
+	game_module_init(module);
+}
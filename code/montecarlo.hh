@@ -0,0 +1,199 @@
+// Monte Carlo move selection. Every legal move is scored by the mean score of
+// random games played out after it. Rollouts are split into chunks that run
+// on the job pool, each worker draws from its own pcg stream and adds into
+// its own accumulators, and a rollout is nothing more than a Board on the
+// stack, so nothing is allocated or shared while they run.
+//
+// A search plays at least its minimum of rollouts after every move, and past
+// that keeps playing rounds of the same size for as long as its time budget
+// allows. montecarlo_start runs a search on the MonteCarlo's own thread, the
+// same way solver_start does, so a few thousand rollouts don't hold up the
+// frame, and montecarlo_poll picks up its result once it's done.
+
+const int MONTECARLO_CHUNK_SIZE = 64;//rollouts per task
+
+typedef struct MonteCarloWorker {
+	PCG rng;
+	double score_sums[MOVE_RIGHT + 1];
+	int64 rollouts;
+	int64 moves;
+	byte pad[64];// keeps neighbouring workers' accumulators off each other's cache lines
+} MonteCarloWorker;
+
+typedef struct MonteCarloResult {
+	int32 move;// MOVE_NONE when no move changes the board
+	float mean_score;
+	int64 rollouts;
+	int64 moves;
+	double time;
+	double rollouts_per_second;
+} MonteCarloResult;
+
+typedef enum MonteCarloState {
+	MONTECARLO_STATE_IDLE,
+	MONTECARLO_STATE_BUSY,// searching on the MonteCarlo's thread
+	MONTECARLO_STATE_DONE,// until montecarlo_poll takes the result
+} MonteCarloState;
+
+typedef struct MonteCarlo {
+	JobPool* jobs;
+	MonteCarloWorker workers[JOB_WORKERS_MAX];
+	thread_atomic_int_t cancel;
+
+	//the search montecarlo_start hands to the MonteCarlo's thread
+	thread_ptr_t thread;
+	thread_signal_t start;
+	thread_atomic_int_t state;// a MonteCarloState
+	thread_atomic_int_t quit;
+	Board search_board;
+	int32 search_rollouts_min;
+	double search_budget;
+	MonteCarloResult search_result;
+
+	//the current search's tasks, each one a chunk of rollouts after one move
+	Board board;
+	int32 chunks_per_move;
+	int32 moves_size;
+	int32 moves[4];
+} MonteCarlo;
+
+
+uint32 montecarlo_rollout(Board board, PCG* rng, int64* moves) {
+	//plays moves chosen uniformly among the legal ones until the game is lost and returns the score it earned on the way
+	uint32 score = 0;
+	while(1) {
+		Board moved;
+		int32 move = board_random_move(board, rng, &moved);
+		if(move == MOVE_NONE) break;
+		score += board_move_score(board, move);
+		board = board_spawn(moved, rng);
+		*moves += 1;
+	}
+	return score;
+}
+
+static void montecarlo__task(void* data, int32 task_i, int32 worker_i) {
+	MonteCarlo* mc = (MonteCarlo*)data;
+	MonteCarloWorker* worker = &mc->workers[worker_i];
+	if(thread_atomic_int_load(&mc->cancel)) return;
+	int32 move_i = task_i/mc->chunks_per_move;
+	int32 move = mc->moves[move_i];
+	Board board = mc->board;
+	uint32 move_score = board_move_score(board, move);
+	Board moved = board_move(board, move);
+	double sum = 0;
+	for_each_lt(i, MONTECARLO_CHUNK_SIZE) {
+		sum += move_score + montecarlo_rollout(board_spawn(moved, &worker->rng), &worker->rng, &worker->moves);
+	}
+	worker->score_sums[move] += sum;
+	worker->rollouts += MONTECARLO_CHUNK_SIZE;
+}
+
+
+MonteCarloResult montecarlo_search(MonteCarlo* mc, Board board, int32 rollouts_per_move_min, double time_budget);
+static int montecarlo__thread_proc(void* data) {
+	MonteCarlo* mc = (MonteCarlo*)data;
+	while(1) {
+		thread_signal_wait(&mc->start, THREAD_SIGNAL_WAIT_INFINITE);
+		if(thread_atomic_int_load(&mc->quit)) break;
+		mc->search_result = montecarlo_search(mc, mc->search_board, mc->search_rollouts_min, mc->search_budget);
+		thread_atomic_int_store(&mc->state, MONTECARLO_STATE_DONE);
+	}
+	return 0;
+}
+
+
+void montecarlo_init(MonteCarlo* mc, JobPool* jobs, uint64 seed) {
+	memzero(mc, 1);
+	mc->jobs = jobs;
+	//one stream per worker, so no two workers ever play out the same sequence of spawns
+	for_each_lt(i, JOB_WORKERS_MAX) pcg_seeds(&mc->workers[i].rng, seed, i);
+	thread_signal_init(&mc->start);
+	mc->thread = thread_create(montecarlo__thread_proc, mc, "monte carlo", THREAD_STACK_SIZE_DEFAULT);
+}
+void montecarlo_cancel(MonteCarlo* mc) {
+	//stops a search montecarlo_start began and throws away its result, after this the job pool is free for others to use
+	if(thread_atomic_int_load(&mc->state) == MONTECARLO_STATE_IDLE) return;
+	thread_atomic_int_store(&mc->cancel, 1);
+	while(thread_atomic_int_load(&mc->state) != MONTECARLO_STATE_DONE) thread_yield();
+	thread_atomic_int_store(&mc->cancel, 0);
+	thread_atomic_int_store(&mc->state, MONTECARLO_STATE_IDLE);
+}
+void montecarlo_term(MonteCarlo* mc) {
+	montecarlo_cancel(mc);
+	thread_atomic_int_store(&mc->quit, 1);
+	thread_signal_raise(&mc->start);
+	thread_join(mc->thread);
+	thread_destroy(mc->thread);
+	thread_signal_term(&mc->start);
+}
+
+MonteCarloResult montecarlo_search(MonteCarlo* mc, Board board, int32 rollouts_per_move_min, double time_budget) {
+	MonteCarloResult result = {};
+	uint64 t0 = SDL_GetPerformanceCounter();
+	mc->board = board;
+	mc->moves_size = 0;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		if(board_move(board, move) != board) {
+			mc->moves[mc->moves_size] = move;
+			mc->moves_size += 1;
+		}
+	}
+	if(mc->moves_size == 0) return result;
+
+	int32 workers_total = jobs_workers_total(mc->jobs);
+	for_each_in(MonteCarloWorker, worker, mc->workers, workers_total) {
+		memzero(worker->score_sums, MOVE_RIGHT + 1);
+		worker->rollouts = 0;
+		worker->moves = 0;
+	}
+	mc->chunks_per_move = max((rollouts_per_move_min + MONTECARLO_CHUNK_SIZE - 1)/MONTECARLO_CHUNK_SIZE, 1);
+	int32 rounds = 0;
+	while(1) {
+		uint64 round_t0 = SDL_GetPerformanceCounter();
+		jobs_run(mc->jobs, montecarlo__task, mc, mc->moves_size*mc->chunks_per_move);
+		rounds += 1;
+		if(thread_atomic_int_load(&mc->cancel)) break;
+		//the first round is the minimum, after it another one only runs if a round as long as the last still fits in the budget
+		uint64 round_t1 = SDL_GetPerformanceCounter();
+		if(get_delta_time(t0, round_t1) + get_delta_time(round_t0, round_t1) > time_budget) break;
+	}
+
+	double score_sums[MOVE_RIGHT + 1] = {};
+	for_each_in(MonteCarloWorker, worker, mc->workers, workers_total) {
+		for_each_lt(move, MOVE_RIGHT + 1) score_sums[move] += worker->score_sums[move];
+		result.rollouts += worker->rollouts;
+		result.moves += worker->moves;
+	}
+	double rollouts_per_move_done = cast(double, rounds)*mc->chunks_per_move*MONTECARLO_CHUNK_SIZE;
+	result.move = mc->moves[0];
+	result.mean_score = score_sums[result.move]/rollouts_per_move_done;
+	for_each_in(int32, move, mc->moves, mc->moves_size) {
+		float mean_score = score_sums[*move]/rollouts_per_move_done;
+		if(mean_score > result.mean_score) {
+			result.move = *move;
+			result.mean_score = mean_score;
+		}
+	}
+	result.time = get_delta_time(t0, SDL_GetPerformanceCounter());
+	result.rollouts_per_second = result.rollouts/max(result.time, 1e-9);
+	return result;
+}
+
+bool montecarlo_start(MonteCarlo* mc, Board board, int32 rollouts_per_move_min, double time_budget) {
+	//returns 0 and does nothing while the last search is still running or its result hasn't been taken by montecarlo_poll
+	if(thread_atomic_int_load(&mc->state) != MONTECARLO_STATE_IDLE) return 0;
+	mc->search_board = board;
+	mc->search_rollouts_min = rollouts_per_move_min;
+	mc->search_budget = time_budget;
+	thread_atomic_int_store(&mc->state, MONTECARLO_STATE_BUSY);
+	thread_signal_raise(&mc->start);
+	return 1;
+}
+bool montecarlo_poll(MonteCarlo* mc, MonteCarloResult* ret_result) {
+	//returns 1 once for every search montecarlo_start began, when it has finished
+	if(thread_atomic_int_load(&mc->state) != MONTECARLO_STATE_DONE) return 0;
+	*ret_result = mc->search_result;
+	thread_atomic_int_store(&mc->state, MONTECARLO_STATE_IDLE);
+	return 1;
+}
@@ -0,0 +1,149 @@
+// N-tuple network trainer. Plays games with the network on every core,
+// learning from each move as it is played, and keeps the weights in a
+// mapped file that the game then picks its n-tuple hints from, see
+// ntuple.hh. Training an existing file carries on from where it stopped. It
+// shares board.hh and ntuple.hh with the game and depends on neither SDL
+// nor Vulkan.
+//
+// usage: ntuple [games] [--out file] [--seed N] [--threads N] [--alpha A]
+//
+// --alpha is the learning rate, the fraction of its error a board's value is
+// moved by with each update.
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+
+#define min gb_min
+#define max gb_max
+
+#include "board.hh"
+#include "ntuple.hh"
+#include "jobs.hh"
+
+const int NTUPLE_GAMES_PER_TASK = 16;
+const int NTUPLE_TASKS_PER_ROUND = 64;//progress is printed after every round
+const int64 NTUPLE_DEFAULT_GAMES = 100000;
+const float NTUPLE_DEFAULT_ALPHA = 0.1f;
+
+typedef struct NtupleWorker {
+	double score_sum;
+	int64 games;
+	int64 moves;
+	int64 max_exponent_counts[BOARD_EXPONENT_MAX + 1];
+	byte pad[64];
+} NtupleWorker;
+
+typedef struct NtupleTrainer {
+	Ntuple net;
+	JobPool* jobs;
+	uint64 seed;
+	float alpha;
+	uint64 round_game_start;// counts every game the file was ever trained on, so a resumed training plays new games
+	int64 round_games_size;
+	NtupleWorker workers[JOB_WORKERS_MAX];
+} NtupleTrainer;
+
+
+static void ntuple_train_task(void* data, int32 task_i, int32 worker_i) {
+	NtupleTrainer* trainer = (NtupleTrainer*)data;
+	NtupleWorker* worker = &trainer->workers[worker_i];
+	int64 first = cast(int64, task_i)*NTUPLE_GAMES_PER_TASK;
+	int64 end = min(first + NTUPLE_GAMES_PER_TASK, trainer->round_games_size);
+	for(int64 i = first; i < end; i += 1) {
+		//every game gets its own stream, so which games are played doesn't depend on the threads
+		PCG rng;
+		pcg_seeds(&rng, trainer->seed, trainer->round_game_start + i);
+		int64 moves;
+		uint32 max_exponent;
+		worker->score_sum += ntuple_train_game(&trainer->net, &rng, trainer->alpha, &moves, &max_exponent);
+		worker->games += 1;
+		worker->moves += moves;
+		worker->max_exponent_counts[max_exponent] += 1;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	int64 games_total = NTUPLE_DEFAULT_GAMES;
+	uint64 seed = 12;
+	const char* out_filename = NTUPLE_FILENAME;
+	int32 threads = -1;
+	float alpha = NTUPLE_DEFAULT_ALPHA;
+	for_each_in_range(i, 1, argc - 1) {
+		MamString arg = mam_tostr(argv[i]);
+		if(mam_cstreq(arg, "--seed") && i + 1 < argc) {
+			mam_strtouint64(mam_tostr(argv[i + 1]), &seed);
+			i += 1;
+		} else if(mam_cstreq(arg, "--out") && i + 1 < argc) {
+			out_filename = argv[i + 1];
+			i += 1;
+		} else if(mam_cstreq(arg, "--threads") && i + 1 < argc) {
+			mam_strtoint32(mam_tostr(argv[i + 1]), &threads);
+			i += 1;
+		} else if(mam_cstreq(arg, "--alpha") && i + 1 < argc) {
+			alpha = gb_clamp01(atof(argv[i + 1]));
+			i += 1;
+		} else {
+			games_total = max(atoll(argv[i]), 1ll);
+		}
+	}
+	if(threads < 1) threads = jobs_cpu_count();
+	board_init_tables();
+
+	NtupleTrainer* trainer = malloct(NtupleTrainer, 1);
+	memzero(trainer, 1);
+	FILE* existing = fopen(out_filename, "rb");
+	if(existing) fclose(existing);
+	if(!existing && !ntuple_create(out_filename)) {
+		printf("Could not create %s\n", out_filename);
+		return 1;
+	}
+	if(!ntuple_map(&trainer->net, out_filename, 1)) {
+		printf("Could not map %s\n", out_filename);
+		return 1;
+	}
+	NtupleHeader* header = trainer->net.header;
+	if(header->games > 0) printf("resuming training of %s after %llu games\n", out_filename, cast(unsigned long long, header->games));
+	trainer->seed = seed;
+	trainer->alpha = alpha;
+	JobPool* jobs = malloct(JobPool, 1);
+	jobs_init(jobs, threads - 1);
+	trainer->jobs = jobs;
+
+	double t0 = jobs_time();
+	for(int64 game_start = 0; game_start < games_total; game_start += NTUPLE_GAMES_PER_TASK*NTUPLE_TASKS_PER_ROUND) {
+		trainer->round_game_start = header->games;
+		trainer->round_games_size = min(games_total - game_start, cast(int64, NTUPLE_GAMES_PER_TASK*NTUPLE_TASKS_PER_ROUND));
+		for_each_in(NtupleWorker, worker, trainer->workers, jobs_workers_total(jobs)) memzero(worker, 1);
+		int32 tasks = (trainer->round_games_size + NTUPLE_GAMES_PER_TASK - 1)/NTUPLE_GAMES_PER_TASK;
+		jobs_run(jobs, ntuple_train_task, trainer, tasks);
+
+		NtupleWorker round = {};
+		for_each_in(NtupleWorker, worker, trainer->workers, jobs_workers_total(jobs)) {
+			round.score_sum += worker->score_sum;
+			round.games += worker->games;
+			round.moves += worker->moves;
+			for_each_lt(e, BOARD_EXPONENT_MAX + 1) round.max_exponent_counts[e] += worker->max_exponent_counts[e];
+		}
+		header->games += round.games;
+		header->moves += round.moves;
+		int64 reached_2048 = 0;
+		for_each_in_range(e, 11, BOARD_EXPONENT_MAX) reached_2048 += round.max_exponent_counts[e];
+		double time = jobs_time() - t0;
+		printf("%llu games: mean score %.0f, 2048 reached %.1f%%, %.2fM games per hour\n", cast(unsigned long long, header->games), round.score_sum/round.games, 100.0*reached_2048/round.games, (game_start + round.games)/time*3600/1000000.0);
+	}
+	double time = jobs_time() - t0;
+	printf("%lld games in %.1fs on %d threads, %llu trained on in total, weights in %s\n", cast(long long, games_total), time, jobs_workers_total(jobs), cast(unsigned long long, header->games), out_filename);
+
+	jobs_term(jobs);
+	free(jobs);
+	ntuple_unmap(&trainer->net);
+	free(trainer);
+	return 0;
+}
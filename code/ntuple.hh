@@ -0,0 +1,230 @@
+// An n-tuple network, the learned board evaluator behind the n-tuple
+// autoplayer, and the TD(0) learning that the ntuple tool trains it with.
+// The network is the usual 4 tuples of 6 cells, each looked up in all 8
+// symmetries of the board, so a board's value is the sum of 32 weights each
+// picked by the exponents under one tuple's cells. The weights are one file,
+// a 16^6 float table per tuple after an NtupleHeader, that the game maps read
+// only and the tool maps writable, so neither ever loads or saves them: the
+// game can hint with a network the moment it starts and training updates
+// the file in place.
+//
+// Learning is on afterstates, the board right after a move and before its
+// spawn: a move is picked by its score plus the value of its afterstate, and
+// the value of the previous afterstate is pulled towards that. The tool runs
+// games on every worker at once and they all update the one mapped table
+// without any locking, any update lost to another worker's is just noise
+// that the learning absorbs.
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint32 NTUPLE_MAGIC = tobyte32('g', 'n', 't', 'p');
+const uint32 NTUPLE_VERSION = 1;
+const int NTUPLE_TUPLES_SIZE = 4;
+const int NTUPLE_TUPLE_LENGTH = 6;
+const int NTUPLE_SYMMETRIES_SIZE = 8;
+const int NTUPLE_LOOKUPS_SIZE = NTUPLE_TUPLES_SIZE*NTUPLE_SYMMETRIES_SIZE;
+const int64 NTUPLE_TABLE_SIZE = cast(int64, 1) << (4*NTUPLE_TUPLE_LENGTH);// weights per tuple, one for every way to fill its cells
+const int NTUPLE_WEIGHTS_OFFSET = 4096;
+#define NTUPLE_FILENAME "ntuple.bin"//the tool trains it and the game maps it
+
+//cells are x + 4*y, the same as a Board's nibbles
+static const uint8 NTUPLE_TUPLES[NTUPLE_TUPLES_SIZE][NTUPLE_TUPLE_LENGTH] = {
+	{0, 1, 2, 3, 4, 5},
+	{4, 5, 6, 7, 8, 9},
+	{0, 1, 2, 4, 5, 6},
+	{4, 5, 6, 8, 9, 10},
+};
+
+typedef struct NtupleHeader {
+	uint32 magic;
+	uint32 version;
+	int32 tuples_size;
+	int32 tuple_length;
+	uint64 games;// trained on so far
+	uint64 moves;
+	uint64 weights_offset;
+	uint64 file_size;
+} NtupleHeader;
+
+typedef struct Ntuple {
+	//a mapped weights file, header is 0 when nothing is mapped
+	NtupleHeader* header;
+	float* weights;// NTUPLE_TUPLES_SIZE tables of NTUPLE_TABLE_SIZE weights
+	uint8 shifts[NTUPLE_LOOKUPS_SIZE][NTUPLE_TUPLE_LENGTH];// of every cell of every tuple in every symmetry
+} Ntuple;
+
+
+static inline uint64 ntuple_file_size() {
+	return NTUPLE_WEIGHTS_OFFSET + NTUPLE_TUPLES_SIZE*NTUPLE_TABLE_SIZE*sizeof(float);
+}
+
+static void ntuple__init_shifts(Ntuple* net) {
+	//symmetry s transposes the board when bit 2 is set, then mirrors x with bit 0 and y with bit 1, which covers all 8
+	for_each_lt(t, NTUPLE_TUPLES_SIZE) {
+		for_each_lt(s, NTUPLE_SYMMETRIES_SIZE) {
+			for_each_lt(i, NTUPLE_TUPLE_LENGTH) {
+				int32 x = NTUPLE_TUPLES[t][i]%BOARD_SIZE;
+				int32 y = NTUPLE_TUPLES[t][i]/BOARD_SIZE;
+				if(s&4) {
+					int32 t0 = x;
+					x = y;
+					y = t0;
+				}
+				if(s&1) x = BOARD_SIZE - 1 - x;
+				if(s&2) y = BOARD_SIZE - 1 - y;
+				net->shifts[NTUPLE_SYMMETRIES_SIZE*t + s][i] = 4*(x + BOARD_SIZE*y);
+			}
+		}
+	}
+}
+
+static inline uint32 ntuple__index(Ntuple* net, Board board, int32 lookup_i) {
+	uint8* shifts = net->shifts[lookup_i];
+	uint32 index = 0;
+	for_each_lt(i, NTUPLE_TUPLE_LENGTH) index |= ((board >> shifts[i]) & 0xf) << (4*i);
+	return index;
+}
+static inline float* ntuple__table(Ntuple* net, int32 lookup_i) {
+	return net->weights + (lookup_i/NTUPLE_SYMMETRIES_SIZE)*NTUPLE_TABLE_SIZE;
+}
+
+static inline float ntuple_value(Ntuple* net, Board board) {
+	float value = 0;
+	for_each_lt(l, NTUPLE_LOOKUPS_SIZE) value += ntuple__table(net, l)[ntuple__index(net, board, l)];
+	return value;
+}
+static inline void ntuple_learn(Ntuple* net, Board board, float delta) {
+	//adds delta to board's value, split evenly between the weights it sums
+	float step = delta/NTUPLE_LOOKUPS_SIZE;
+	for_each_lt(l, NTUPLE_LOOKUPS_SIZE) ntuple__table(net, l)[ntuple__index(net, board, l)] += step;
+}
+
+int32 ntuple_best_move(Ntuple* net, Board board, Board* ret_afterstate, uint32* ret_score) {
+	//the move with the most score plus afterstate value, MOVE_NONE when no move changes the board
+	int32 best_move = MOVE_NONE;
+	float best_value = 0;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		Board moved = board_move(board, move);
+		if(moved == board) continue;
+		uint32 score = board_move_score(board, move);
+		float value = score + ntuple_value(net, moved);
+		if(best_move == MOVE_NONE || value > best_value) {
+			best_move = move;
+			best_value = value;
+			if(ret_afterstate) *ret_afterstate = moved;
+			if(ret_score) *ret_score = score;
+		}
+	}
+	return best_move;
+}
+
+uint32 ntuple_train_game(Ntuple* net, PCG* rng, float alpha, int64* ret_moves, uint32* ret_max_exponent) {
+	//plays one game by the network and learns from it as it goes, returns its score
+	Board board = board_new_game(rng);
+	uint32 total_score = 0;
+	int64 moves = 0;
+	Board afterstate = 0;
+	bool has_afterstate = 0;
+	while(1) {
+		Board next_afterstate;
+		uint32 score;
+		int32 move = ntuple_best_move(net, board, &next_afterstate, &score);
+		if(move == MOVE_NONE) {
+			//nothing more can be scored after the last afterstate
+			if(has_afterstate) ntuple_learn(net, afterstate, -alpha*ntuple_value(net, afterstate));
+			break;
+		}
+		if(has_afterstate) {
+			float target = score + ntuple_value(net, next_afterstate);
+			ntuple_learn(net, afterstate, alpha*(target - ntuple_value(net, afterstate)));
+		}
+		afterstate = next_afterstate;
+		has_afterstate = 1;
+		total_score += score;
+		moves += 1;
+		board = board_spawn(afterstate, rng);
+	}
+	*ret_moves = moves;
+	*ret_max_exponent = board_max_exponent(board);
+	return total_score;
+}
+
+
+static void ntuple__unmap(void* base, uint64 file_size) {
+	#ifdef _WIN32
+	UnmapViewOfFile(base);
+	#else
+	munmap(base, file_size);
+	#endif
+}
+void ntuple_unmap(Ntuple* net) {
+	if(net->header) ntuple__unmap(net->header, net->header->file_size);
+	net->header = 0;
+	net->weights = 0;
+}
+bool ntuple_create(const char* filename) {
+	//writes a network with every weight 0, the weights are left as a hole in the file wherever the file system can
+	FILE* file = fopen(filename, "wb");
+	if(!file) return 0;
+	NtupleHeader header = {};
+	header.magic = NTUPLE_MAGIC;
+	header.version = NTUPLE_VERSION;
+	header.tuples_size = NTUPLE_TUPLES_SIZE;
+	header.tuple_length = NTUPLE_TUPLE_LENGTH;
+	header.weights_offset = NTUPLE_WEIGHTS_OFFSET;
+	header.file_size = ntuple_file_size();
+	byte last = 0;
+	bool is_written = fwrite(&header, sizeof(NtupleHeader), 1, file) == 1
+		&& fseeko(file, header.file_size - 1, SEEK_SET) == 0
+		&& fwrite(&last, 1, 1, file) == 1;
+	is_written = (fclose(file) == 0) && is_written;
+	return is_written;
+}
+bool ntuple_map(Ntuple* net, const char* filename, bool is_writable) {
+	//writable maps share the file, every update to the weights goes straight to it
+	memzero(net, 1);
+	byte* base = 0;
+	uint64 file_size = 0;
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ | (is_writable ? GENERIC_WRITE : 0), FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if(GetFileSizeEx(file, &size)) file_size = size.QuadPart;
+		HANDLE mapping = CreateFileMappingA(file, 0, is_writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, 0);
+		if(mapping) {
+			base = cast(byte*, MapViewOfFile(mapping, is_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+	}
+	#else
+	int file = open(filename, is_writable ? O_RDWR : O_RDONLY);
+	if(file >= 0) {
+		struct stat info;
+		if(fstat(file, &info) == 0) file_size = info.st_size;
+		if(file_size > 0) {
+			void* mem = mmap(0, file_size, is_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+			if(mem != MAP_FAILED) base = cast(byte*, mem);
+		}
+		close(file);
+	}
+	#endif
+	if(!base) return 0;
+
+	NtupleHeader* header = cast(NtupleHeader*, base);
+	bool is_valid = file_size >= sizeof(NtupleHeader) && header->magic == NTUPLE_MAGIC && header->version == NTUPLE_VERSION && header->tuples_size == NTUPLE_TUPLES_SIZE && header->tuple_length == NTUPLE_TUPLE_LENGTH && header->weights_offset == NTUPLE_WEIGHTS_OFFSET && header->file_size == file_size && file_size == ntuple_file_size();
+	if(!is_valid) {
+		printf("Invalid n-tuple network file: %s\n", filename);
+		ntuple__unmap(base, file_size);
+		return 0;
+	}
+	net->header = header;
+	net->weights = ptr_add(float, base, header->weights_offset);
+	ntuple__init_shifts(net);
+	return 1;
+}
@@ -0,0 +1,227 @@
+// Pools of fixed size blocks, for things that come and go in no particular
+// order and so can't live on a stack. A pool hands out blocks of one size
+// from chunks it takes from a parent allocator, and keeps the blocks that
+// are free in a list threaded through the blocks themselves, so taking a
+// block and giving it back are both a couple of pointer moves. Chunks are
+// only ever given back to the parent all at once, by pool_term or a
+// freeall, and newest first, so the parent can be a stack as long as
+// nothing else is pushed on it above the pool's chunks and something is
+// under them, a mamlib stack won't pop the first thing pushed on it.
+//
+// pool_allocator is a MamAllocatorFunc with the Pool as its data, so a pool
+// can be handed to anything that takes an allocator. A realloc only works
+// while the new size still fits in a block, past that it's a fatal error
+// the same as an alloc that is too big.
+//
+// A pool is not thread safe on its own. Threads that share one take and give
+// back blocks through a PoolCache each, with pool_cache_allocator, and only
+// touch the pool itself, under its lock, once every POOL_CACHE_BATCH blocks.
+
+const inta POOL_CACHE_BATCH = 32;
+#ifdef MAMLIB_DEBUG
+const inta POOL_CHECK_SIZE = MAM_CHECK_FULL_SIZE;//mam_check_allocation puts its cookies around every block
+#else
+const inta POOL_CHECK_SIZE = 0;
+#endif
+
+typedef struct PoolBlock {
+	PoolBlock* next;
+} PoolBlock;
+typedef struct PoolChunk {
+	PoolChunk* next;
+} PoolChunk;
+
+typedef struct Pool {
+	inta block_size;// of every block, what mam_check_allocation adds included
+	inta chunk_blocks;// taken from the parent at a time
+	MamAllocatorFunc* parent;
+	void* parent_data;
+	PoolBlock* free_list;
+	PoolChunk* chunks;// newest first
+	inta blocks_total;// in every chunk
+	inta blocks_used;// out of the pool, blocks sitting in a PoolCache included
+	inta highest_blocks_used;
+	thread_mutex_t lock;// only taken by caches
+} Pool;
+
+typedef struct PoolCache {
+	//one thread's share of a pool
+	Pool* pool;
+	PoolBlock* free_list;
+	inta free_size;
+} PoolCache;
+
+
+void pool_init(Pool* pool, inta object_size, inta chunk_blocks, MamAllocatorFunc* parent, void* parent_data) {
+	memzero(pool, 1);
+	inta block_size = mam_align(object_size + POOL_CHECK_SIZE);
+	if(block_size < cast(inta, sizeof(PoolBlock))) block_size = mam_align(sizeof(PoolBlock));
+	pool->block_size = block_size;
+	pool->chunk_blocks = chunk_blocks < 1 ? 1 : chunk_blocks;
+	pool->parent = parent;
+	pool->parent_data = parent_data;
+	thread_mutex_init(&pool->lock);
+}
+
+static void pool__free_chunks(Pool* pool) {
+	PoolChunk* chunk = pool->chunks;
+	while(chunk) {
+		PoolChunk* next = chunk->next;
+		mam_gen_free(pool->parent, pool->parent_data, chunk);
+		chunk = next;
+	}
+	pool->chunks = 0;
+	pool->free_list = 0;
+	pool->blocks_total = 0;
+	pool->blocks_used = 0;
+}
+void pool_term(Pool* pool) {
+	//gives every chunk back to the parent, every block and cache of the pool is invalid after this
+	pool__free_chunks(pool);
+	thread_mutex_term(&pool->lock);
+}
+
+static void pool__grow(Pool* pool) {
+	//takes a new chunk from the parent and puts all of its blocks on the free list
+	inta header_size = mam_align(sizeof(PoolChunk));
+	PoolChunk* chunk = cast(PoolChunk*, mam_gen_malloc(pool->parent, pool->parent_data, header_size + pool->chunk_blocks*pool->block_size));
+	if(!chunk) {
+		MAM_ERRORL("Could not allocate a chunk for a pool");
+	}
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	byte* blocks = ptr_add(byte, chunk, header_size);
+	//threaded back to front, so blocks are handed out in the order they lie in memory
+	for(inta i = pool->chunk_blocks - 1; i >= 0; i -= 1) {
+		PoolBlock* block = cast(PoolBlock*, blocks + i*pool->block_size);
+		block->next = pool->free_list;
+		pool->free_list = block;
+	}
+	pool->blocks_total += pool->chunk_blocks;
+}
+
+static inline void pool__check_size(Pool* pool, mam_int alloc_size) {
+	if(alloc_size > pool->block_size) {
+		MAM_ERRORL("Allocation is bigger than the blocks of its pool");
+	}
+}
+static inline void pool__count_used(Pool* pool, inta blocks) {
+	pool->blocks_used += blocks;
+	if(pool->highest_blocks_used < pool->blocks_used) pool->highest_blocks_used = pool->blocks_used;
+}
+
+void* pool__allocator(MamAllocMode mode, mam_int alloc_size, void* old_ptr, void* allocator_data) {
+	Pool* pool = cast(Pool*, allocator_data);
+	if(mode == MAM_MODE_ALLOC) {
+		pool__check_size(pool, alloc_size);
+		if(!pool->free_list) pool__grow(pool);
+		PoolBlock* block = pool->free_list;
+		pool->free_list = block->next;
+		pool__count_used(pool, 1);
+		return block;
+	} else if(mode == MAM_MODE_REALLOC && alloc_size) {
+		//every block is already as big as it can get
+		pool__check_size(pool, alloc_size);
+		return old_ptr;
+	} else if(mode == MAM_MODE_FREE || (mode == MAM_MODE_REALLOC && !alloc_size)) {
+		if(!old_ptr) return 0;
+		PoolBlock* block = cast(PoolBlock*, old_ptr);
+		block->next = pool->free_list;
+		pool->free_list = block;
+		pool->blocks_used -= 1;
+	} else if(mode == MAM_MODE_FREEALL) {
+		pool__free_chunks(pool);
+	}
+	return 0;
+}
+void* pool_allocator(MamAllocMode mode, mam_int alloc_size, void* old_ptr, void* allocator_data) {
+	return mam_check_allocation(&pool__allocator, allocator_data, mode, alloc_size, old_ptr);
+}
+
+//macros so that with MEMPROF a block is logged where it was taken, see memprof.hh
+#define pool_alloc(pool) mam_gen_malloc(pool_allocator, pool, (pool)->block_size - POOL_CHECK_SIZE)
+#define pool_free(pool, ptr) ((void)mam_gen_free(pool_allocator, pool, ptr))
+#define pool_alloct(type, pool) ((type*)pool_alloc(pool))
+
+
+void pool_cache_init(PoolCache* cache, Pool* pool) {
+	memzero(cache, 1);
+	cache->pool = pool;
+}
+void pool_cache_flush(PoolCache* cache) {
+	//gives every block the cache holds back to its pool
+	if(!cache->free_list) return;
+	PoolBlock* last = cache->free_list;
+	while(last->next) last = last->next;
+	Pool* pool = cache->pool;
+	thread_mutex_lock(&pool->lock);
+	last->next = pool->free_list;
+	pool->free_list = cache->free_list;
+	pool->blocks_used -= cache->free_size;
+	thread_mutex_unlock(&pool->lock);
+	cache->free_list = 0;
+	cache->free_size = 0;
+}
+
+static void pool__cache_refill(PoolCache* cache) {
+	Pool* pool = cache->pool;
+	thread_mutex_lock(&pool->lock);
+	for_each_lt(i, POOL_CACHE_BATCH) {
+		if(!pool->free_list) pool__grow(pool);
+		PoolBlock* block = pool->free_list;
+		pool->free_list = block->next;
+		block->next = cache->free_list;
+		cache->free_list = block;
+	}
+	pool__count_used(pool, POOL_CACHE_BATCH);
+	thread_mutex_unlock(&pool->lock);
+	cache->free_size += POOL_CACHE_BATCH;
+}
+static void pool__cache_spill(PoolCache* cache) {
+	//gives the pool a batch back, the cache keeps the rest so a thread that frees and allocates in turn doesn't lock every time
+	Pool* pool = cache->pool;
+	PoolBlock* first = cache->free_list;
+	PoolBlock* last = first;
+	for_each_lt(i, POOL_CACHE_BATCH - 1) last = last->next;
+	cache->free_list = last->next;
+	cache->free_size -= POOL_CACHE_BATCH;
+	thread_mutex_lock(&pool->lock);
+	last->next = pool->free_list;
+	pool->free_list = first;
+	pool->blocks_used -= POOL_CACHE_BATCH;
+	thread_mutex_unlock(&pool->lock);
+}
+
+void* pool__cache_allocator(MamAllocMode mode, mam_int alloc_size, void* old_ptr, void* allocator_data) {
+	PoolCache* cache = cast(PoolCache*, allocator_data);
+	if(mode == MAM_MODE_ALLOC) {
+		pool__check_size(cache->pool, alloc_size);
+		if(!cache->free_list) pool__cache_refill(cache);
+		PoolBlock* block = cache->free_list;
+		cache->free_list = block->next;
+		cache->free_size -= 1;
+		return block;
+	} else if(mode == MAM_MODE_REALLOC && alloc_size) {
+		pool__check_size(cache->pool, alloc_size);
+		return old_ptr;
+	} else if(mode == MAM_MODE_FREE || (mode == MAM_MODE_REALLOC && !alloc_size)) {
+		//a block can be given back to any cache of its pool, not just the one it came from
+		if(!old_ptr) return 0;
+		PoolBlock* block = cast(PoolBlock*, old_ptr);
+		block->next = cache->free_list;
+		cache->free_list = block;
+		cache->free_size += 1;
+		if(cache->free_size >= 2*POOL_CACHE_BATCH) pool__cache_spill(cache);
+	} else if(mode == MAM_MODE_FREEALL) {
+		//only flushes the cache, the pool's other caches may still be using its chunks
+		pool_cache_flush(cache);
+	}
+	return 0;
+}
+void* pool_cache_allocator(MamAllocMode mode, mam_int alloc_size, void* old_ptr, void* allocator_data) {
+	return mam_check_allocation(&pool__cache_allocator, allocator_data, mode, alloc_size, old_ptr);
+}
+
+#define pool_cache_alloc(cache) mam_gen_malloc(pool_cache_allocator, cache, (cache)->pool->block_size - POOL_CHECK_SIZE)
+#define pool_cache_free(cache, ptr) ((void)mam_gen_free(pool_cache_allocator, cache, ptr))
+#define pool_cache_alloct(type, cache) ((type*)pool_cache_alloc(cache))
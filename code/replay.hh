@@ -0,0 +1,194 @@
+// Records everything that feeds into game_update so a session can be played
+// back deterministically. The only randomness in the game comes from the rng
+// seed, so a replay is just the seed and grid size plus the input events of
+// every frame.
+// A replay file is a ReplayHeader followed by ReplayRecords sorted by frame.
+
+const uint32 REPLAY_MAGIC = tobyte32('g', 'r', 'p', 'l');
+const uint32 REPLAY_VERSION = 4;//version 2 merges each tile at most once per move, version 3 stores the grid size, version 4 gives keys to undo and redo
+const double REPLAY_DELTA_UNIT = 0.00005;//deltas are stored in units of 50 microseconds
+const int REPLAY_BUFFER_SIZE = 256;
+
+typedef enum ReplayRecordType {
+	REPLAY_RECORD_KEY_DOWN,
+	REPLAY_RECORD_KEY_UP,
+	REPLAY_RECORD_QUIT,
+	REPLAY_RECORD_DELTA,//only written on frames where game_uses_delta is true
+} ReplayRecordType;
+
+typedef struct ReplayHeader {
+	uint32 magic;
+	uint32 version;
+	uint64 seed;
+	int32 grid_w;
+	int32 grid_h;
+	uint32 frames_total;
+	uint32 records_total;
+} ReplayHeader;
+
+typedef struct ReplayRecord {
+	uint32 frame;
+	uint8 type;
+	uint8 repeat;
+	uint16 data;//packed keycode or quantized delta
+} ReplayRecord;
+
+typedef struct ReplayRecorder {
+	SDL_RWops* file;
+	ReplayHeader header;
+	int32 buffer_size;
+	ReplayRecord buffer[REPLAY_BUFFER_SIZE];
+} ReplayRecorder;
+
+
+static uint16 replay_pack_keycode(SDL_Keycode keycode) {
+	//keycodes are either unicode characters or scancodes tagged with SDLK_SCANCODE_MASK, and every key the game cares about fits in 15 bits
+	if(keycode & SDLK_SCANCODE_MASK) {
+		return 0x8000 | (keycode & 0x7fff);
+	} else {
+		return keycode & 0x7fff;
+	}
+}
+static SDL_Keycode replay_unpack_keycode(uint16 data) {
+	if(data & 0x8000) {
+		return (data & 0x7fff) | SDLK_SCANCODE_MASK;
+	} else {
+		return data;
+	}
+}
+static uint16 replay_pack_delta(double delta) {
+	return cast(uint16, min(delta/REPLAY_DELTA_UNIT + 0.5, cast(double, 0xffff)));
+}
+static double replay_unpack_delta(uint16 data) {
+	return data*REPLAY_DELTA_UNIT;
+}
+//NOTE: while recording, the game must be fed the quantized delta so that playback matches exactly
+double replay_quantize_delta(double delta) {
+	return replay_unpack_delta(replay_pack_delta(delta));
+}
+
+
+static void replay_flush(ReplayRecorder* recorder) {
+	SDL_RWwrite(recorder->file, recorder->buffer, sizeof(ReplayRecord), recorder->buffer_size);
+	recorder->header.records_total += recorder->buffer_size;
+	recorder->buffer_size = 0;
+}
+static void replay_push(ReplayRecorder* recorder, uint32 frame, uint8 type, uint8 repeat, uint16 data) {
+	if(recorder->buffer_size >= REPLAY_BUFFER_SIZE) replay_flush(recorder);
+	ReplayRecord* record = &recorder->buffer[recorder->buffer_size];
+	record->frame = frame;
+	record->type = type;
+	record->repeat = repeat;
+	record->data = data;
+	recorder->buffer_size += 1;
+}
+
+bool replay_record_begin(ReplayRecorder* recorder, const char* filename, uint64 seed, int32 grid_w, int32 grid_h) {
+	recorder->file = SDL_RWFromFile(filename, "wb");
+	if(!recorder->file) {
+		printf("Could not open replay file for writing: %s; SDL Error: %s\n", filename, SDL_GetError());
+		return 0;
+	}
+	recorder->header = {};
+	recorder->header.magic = REPLAY_MAGIC;
+	recorder->header.version = REPLAY_VERSION;
+	recorder->header.seed = seed;
+	recorder->header.grid_w = grid_w;
+	recorder->header.grid_h = grid_h;
+	recorder->buffer_size = 0;
+	//the totals are patched in by replay_record_end
+	SDL_RWwrite(recorder->file, &recorder->header, sizeof(ReplayHeader), 1);
+	return 1;
+}
+void replay_record_frame(ReplayRecorder* recorder, uint32 frame, SDL_Event* events, int32 events_size, Game* game, double delta) {
+	if(!recorder->file) return;
+	if(game_uses_delta(game)) {
+		replay_push(recorder, frame, REPLAY_RECORD_DELTA, 0, replay_pack_delta(delta));
+	}
+	for_each_in(SDL_Event, event, events, events_size) {
+		if(event->type == SDL_KEYDOWN || event->type == SDL_KEYUP) {
+			uint8 type = (event->type == SDL_KEYDOWN) ? REPLAY_RECORD_KEY_DOWN : REPLAY_RECORD_KEY_UP;
+			replay_push(recorder, frame, type, event->key.repeat > 0, replay_pack_keycode(event->key.keysym.sym));
+		} else if(event->type == SDL_QUIT || (event->type == SDL_WINDOWEVENT && event->window.event == SDL_WINDOWEVENT_CLOSE)) {
+			replay_push(recorder, frame, REPLAY_RECORD_QUIT, 0, 0);
+		}
+	}
+	recorder->header.frames_total = frame + 1;
+}
+void replay_record_end(ReplayRecorder* recorder) {
+	if(!recorder->file) return;
+	replay_flush(recorder);
+	SDL_RWseek(recorder->file, 0, RW_SEEK_SET);
+	SDL_RWwrite(recorder->file, &recorder->header, sizeof(ReplayHeader), 1);
+	SDL_RWclose(recorder->file);
+	recorder->file = 0;
+}
+
+
+int replay_playback(const char* filename, int32 loops) {
+	//plays the replay back with no window and no frame limiter, doubles as a cpu benchmark of game_update
+	SDL_RWops* file = SDL_RWFromFile(filename, "rb");
+	if(!file) {
+		printf("Could not open replay file: %s; SDL Error: %s\n", filename, SDL_GetError());
+		return 1;
+	}
+	inta file_size = SDL_RWsize(file);
+	ReplayHeader header = {};
+	if(file_size < cast(inta, sizeof(ReplayHeader)) || SDL_RWread(file, &header, sizeof(ReplayHeader), 1) != 1 || header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION || header.grid_w < 1 || header.grid_h < 1 || header.grid_w > GRID_SIZE_MAX || header.grid_h > GRID_SIZE_MAX) {
+		printf("Invalid replay file: %s\n", filename);
+		SDL_RWclose(file);
+		return 1;
+	}
+	//a recording that was never closed still has a valid record stream, only the totals are missing
+	int32 records_size = (file_size - sizeof(ReplayHeader))/sizeof(ReplayRecord);
+	ReplayRecord* records = malloct(ReplayRecord, records_size + 1);
+	records_size = SDL_RWread(file, records, sizeof(ReplayRecord), records_size);
+	SDL_RWclose(file);
+	uint32 frames_total = header.frames_total;
+	if(records_size > 0) frames_total = max(frames_total, records[records_size - 1].frame + 1);
+
+	SDL_Event* events = malloct(SDL_Event, REPLAY_BUFFER_SIZE);
+	int64 frames_played = 0;
+	uint64 hash = 0;
+	uint64 t0 = SDL_GetPerformanceCounter();
+	for_each_lt(loop_i, loops) {
+		GameMemDesc game_desc = game_new(header.seed, header.grid_w, header.grid_h);
+		Game* game = (Game*)game_desc.mem;
+
+		int32 record_i = 0;
+		for(uint32 frame = 0; frame < frames_total; frame += 1) {
+			double delta = DEFAULT_FPS;
+			int32 events_size = 0;
+			for(; record_i < records_size && records[record_i].frame == frame; record_i += 1) {
+				ReplayRecord* record = &records[record_i];
+				if(record->type == REPLAY_RECORD_DELTA) {
+					delta = replay_unpack_delta(record->data);
+				} else if(events_size < REPLAY_BUFFER_SIZE) {
+					SDL_Event* event = &events[events_size];
+					events_size += 1;
+					memzero(event, 1);
+					if(record->type == REPLAY_RECORD_QUIT) {
+						event->type = SDL_QUIT;
+					} else {
+						event->type = (record->type == REPLAY_RECORD_KEY_DOWN) ? SDL_KEYDOWN : SDL_KEYUP;
+						event->key.state = (record->type == REPLAY_RECORD_KEY_DOWN) ? SDL_PRESSED : SDL_RELEASED;
+						event->key.repeat = record->repeat;
+						event->key.keysym.sym = replay_unpack_keycode(record->data);
+					}
+				}
+			}
+			Output output = game_update(game, events, events_size, delta);
+			frames_played += 1;
+			if(output.game_quit) break;
+		}
+
+		for_each_lt(i, game->grid_w*game->grid_h) hash = pcgf__hash64(hash ^ game->grid[i]);
+		game_free_recursively(&game_desc);
+	}
+	double time = get_delta_time(t0, SDL_GetPerformanceCounter());
+	printf("replayed %lld frames in %.3fs (%.0f frames per second), final board hash %016llx\n", cast(long long, frames_played), time, frames_played/time, cast(unsigned long long, hash));
+
+	free(events);
+	free(records);
+	return 0;
+}
@@ -0,0 +1,211 @@
+// Binary saves of a GameMemDesc tree. A save is a SaveHeader followed by
+// every block of the tree in depth first order, each one aligned to
+// SAVE_ALIGN and at its full alloc_size, so the file can be mapped and used
+// in place. In the saved copies the mem of each child GameMemDesc holds an
+// offset instead of a pointer: from the start of the file for separate
+// blocks, from the start of the parent for INTERNAL ones, and 0 for TEMP
+// blocks which aren't saved at all. Blocks ending in a MamStack only have
+// the part of the stack that is in use copied, which is what keeps saving
+// a game down to a few kilobytes of memcpy.
+// Loading maps the file copy on write and turns the offsets back into
+// pointers. Any other pointers into the root block have to be moved by the
+// caller with save_rebase, and TEMP blocks have to be allocated again.
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint32 SAVE_MAGIC = tobyte32('g', 's', 'a', 'v');
+const uint32 SAVE_VERSION = 1;
+const inta SAVE_ALIGN = 64;
+
+typedef struct SaveHeader {
+	uint32 magic;
+	uint32 version;
+	uint64 file_size;
+	uint64 root_address;// where the root block was when it was saved, pointers into it are relative to this
+	uint64 root_alloc_size;
+	int32 root_children_total;
+	uint32 root_flags;
+	uint32 game_size;// sizeof(Game) of the build that saved it, saves from a build with a different layout are refused
+	byte pad[20];
+} SaveHeader;
+
+
+static inline inta save__align(inta size) {
+	return (size + SAVE_ALIGN - 1)/SAVE_ALIGN*SAVE_ALIGN;
+}
+static inline GameMemDesc* save__child(GameMemDesc* desc, int32 i) {
+	return &cast(GameMemDesc*, desc->mem)[i];
+}
+
+static inta save__used_size(GameMemDesc* desc) {
+	//NOTE: an internal stack has to be the last thing in its parent's memory for the rest of the parent to be skipped
+	if(desc->flags & GAME_MEMDESC_STACK) return sizeof(MamStack) + cast(MamStack*, desc->mem)->size;
+	for_each_lt(i, desc->children_total) {
+		GameMemDesc* child = save__child(desc, i);
+		if((child->flags & GAME_MEMDESC_INTERNAL) && (child->flags & GAME_MEMDESC_STACK)) {
+			return ptr_sub(child->mem, desc->mem) + save__used_size(child);
+		}
+	}
+	return desc->alloc_size;
+}
+static inta save__tree_size(GameMemDesc* desc) {
+	inta size = save__align(desc->alloc_size);
+	for_each_lt(i, desc->children_total) {
+		GameMemDesc* child = save__child(desc, i);
+		if(!(child->flags & (GAME_MEMDESC_INTERNAL | GAME_MEMDESC_TEMP))) size += save__tree_size(child);
+	}
+	return size;
+}
+static inta save__write(GameMemDesc* desc, byte* base, inta offset) {
+	//copies desc's block to offset and its children right after it, returns the offset past the last of them
+	byte* block = base + offset;
+	memcpy(block, desc->mem, save__used_size(desc));
+	inta next = offset + save__align(desc->alloc_size);
+	for_each_lt(i, desc->children_total) {
+		GameMemDesc* child = save__child(desc, i);
+		GameMemDesc* saved = &cast(GameMemDesc*, block)[i];
+		saved->flags &= ~(GAME_MEMDESC_MAPPED | GAME_MEMDESC_MAPPING | GAME_MEMDESC_HUGE_TRANSPARENT | GAME_MEMDESC_HUGE_EXPLICIT);
+		if(child->flags & GAME_MEMDESC_INTERNAL) {
+			saved->mem = cast(void*, ptr_sub(child->mem, desc->mem));
+		} else if(child->flags & GAME_MEMDESC_TEMP) {
+			saved->mem = 0;
+		} else {
+			saved->mem = cast(void*, next);
+			next = save__write(child, base, next);
+		}
+	}
+	return next;
+}
+static bool save__relocate(GameMemDesc* desc, byte* base, inta file_size) {
+	for_each_lt(i, desc->children_total) {
+		GameMemDesc* child = save__child(desc, i);
+		inta offset = cast(inta, child->mem);
+		if(child->flags & GAME_MEMDESC_INTERNAL) {
+			if(offset < 0 || offset + child->alloc_size > desc->alloc_size) return 0;
+			child->mem = ptr_add(void, desc->mem, offset);
+		} else if(child->flags & GAME_MEMDESC_TEMP) {
+			child->mem = 0;
+		} else {
+			if(offset < SAVE_ALIGN || child->alloc_size < 0 || offset + child->alloc_size > file_size) return 0;
+			child->mem = base + offset;
+			child->flags |= GAME_MEMDESC_MAPPED;
+			if(child->children_total < 0 || cast(inta, child->children_total*sizeof(GameMemDesc)) > child->alloc_size) return 0;
+			if(!save__relocate(child, base, file_size)) return 0;
+		}
+	}
+	return 1;
+}
+
+
+inta save_size(GameMemDesc* root) {
+	return SAVE_ALIGN + save__tree_size(root);
+}
+inta save_to_buffer(GameMemDesc* root, byte* buffer, inta buffer_size) {
+	//snapshots the tree into buffer, returns the size of the save or 0 if it doesn't fit
+	//the unused ends of stacks are left as they were in buffer
+	inta size = save_size(root);
+	if(buffer_size < size) return 0;
+	SaveHeader* header = cast(SaveHeader*, buffer);
+	memzero(header, 1);
+	header->magic = SAVE_MAGIC;
+	header->version = SAVE_VERSION;
+	header->file_size = size;
+	header->root_address = cast(uint64, cast(uintptr_t, root->mem));
+	header->root_alloc_size = root->alloc_size;
+	header->root_children_total = root->children_total;
+	header->root_flags = root->flags & ~(GAME_MEMDESC_MAPPED | GAME_MEMDESC_MAPPING | GAME_MEMDESC_HUGE_TRANSPARENT | GAME_MEMDESC_HUGE_EXPLICIT);
+	header->game_size = sizeof(Game);
+	save__write(root, buffer, SAVE_ALIGN);
+	return size;
+}
+bool save_to_file(GameMemDesc* root, const char* filename) {
+	inta size = save_size(root);
+	byte* buffer = malloct(byte, size);
+	memzero(buffer, size);
+	save_to_buffer(root, buffer, size);
+	SDL_RWops* file = SDL_RWFromFile(filename, "wb");
+	bool is_written = file && SDL_RWwrite(file, buffer, size, 1) == 1;
+	if(file) SDL_RWclose(file);
+	free(buffer);
+	if(!is_written) printf("Could not write save file: %s; SDL Error: %s\n", filename, SDL_GetError());
+	return is_written;
+}
+
+static void save__unmap(byte* base, inta file_size) {
+	#ifdef _WIN32
+	UnmapViewOfFile(base);
+	#else
+	munmap(base, file_size);
+	#endif
+}
+void save_unmap(GameMemDesc* root) {
+	SaveHeader* header = ptr_add(SaveHeader, root->mem, -SAVE_ALIGN);
+	save__unmap(cast(byte*, header), header->file_size);
+	root->mem = 0;
+}
+bool save_map(const char* filename, GameMemDesc* ret_root) {
+	//maps a save copy on write, so the game can be changed in place without touching the file
+	byte* base = 0;
+	inta file_size = 0;
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if(GetFileSizeEx(file, &size)) file_size = size.QuadPart;
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+		if(mapping) {
+			base = cast(byte*, MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+	}
+	#else
+	int file = open(filename, O_RDONLY);
+	if(file >= 0) {
+		struct stat info;
+		if(fstat(file, &info) == 0) file_size = info.st_size;
+		if(file_size > 0) {
+			void* mem = mmap(0, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+			if(mem != MAP_FAILED) base = cast(byte*, mem);
+		}
+		close(file);
+	}
+	#endif
+	if(!base) {
+		printf("Could not open save file: %s\n", filename);
+		return 0;
+	}
+
+	SaveHeader* header = cast(SaveHeader*, base);
+	if(file_size < SAVE_ALIGN) {
+		printf("Invalid save file: %s\n", filename);
+		save__unmap(base, file_size);
+		return 0;
+	}
+	GameMemDesc root = {};
+	root.mem = base + SAVE_ALIGN;
+	root.alloc_size = header->root_alloc_size;
+	root.children_total = header->root_children_total;
+	root.flags = header->root_flags | GAME_MEMDESC_MAPPED | GAME_MEMDESC_MAPPING;
+	bool is_valid = header->magic == SAVE_MAGIC && header->version == SAVE_VERSION && header->game_size == sizeof(Game) && cast(inta, header->file_size) == file_size;
+	is_valid = is_valid && root.alloc_size >= cast(inta, sizeof(Game)) && SAVE_ALIGN + root.alloc_size <= file_size;
+	is_valid = is_valid && root.children_total >= 0 && cast(inta, root.children_total*sizeof(GameMemDesc)) <= root.alloc_size;
+	is_valid = is_valid && save__relocate(&root, base, file_size);
+	if(!is_valid) {
+		printf("Invalid save file: %s\n", filename);
+		save__unmap(base, file_size);
+		return 0;
+	}
+	*ret_root = root;
+	return 1;
+}
+void* save_rebase(GameMemDesc* root, void* ptr) {
+	//moves a pointer into the root block from where the root was when it was saved to where it is mapped now
+	SaveHeader* header = ptr_add(SaveHeader, root->mem, -SAVE_ALIGN);
+	return ptr_add(void, root->mem, cast(uintptr_t, ptr) - cast(uintptr_t, header->root_address));
+}
@@ -0,0 +1,101 @@
+// Checks that game_load turns down broken saves without crashing and still
+// takes a good one. A save of a new game is written out as it is and with one
+// of the fields game_load checks broken, and every broken one has to fail to
+// load. Run it from a directory it can write save_test.sav to, it exits with
+// 1 on the first check that fails.
+#define MAMLIB_DEBUG
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+#include "SDL.h"
+#include "vulkan/vulkan.h"
+#undef main
+
+#include "vstack.hh"
+#include "huge.hh"
+#include "board.hh"
+#include "grid.hh"
+#include "tween.hh"
+#include "history.hh"
+#include "wall.hh"
+#include "types.hh"
+#include "config.hh"
+#include "save.hh"
+#include "tablebase.hh"
+
+#define min gb_min
+#define max gb_max
+
+#include "game.hh"
+
+#define SAVE_TEST_FILENAME "save_test.sav"
+
+typedef enum SaveBreak {
+	SAVE_BREAK_NONE,
+	SAVE_BREAK_GRID_W,
+	SAVE_BREAK_GRID_DESC,
+	SAVE_BREAK_HISTORY_SIZE,
+	SAVE_BREAK_WALL_SIZE,
+	SAVE_BREAK_MAGIC,
+	SAVE_BREAKS_SIZE,
+} SaveBreak;
+static const char* SAVE_BREAK_NAMES[SAVE_BREAKS_SIZE] = {"none", "grid width", "grid size", "history size", "wall size", "magic"};
+
+
+static bool save_test_write(byte* buffer, inta size) {
+	FILE* file = fopen(SAVE_TEST_FILENAME, "wb");
+	if(!file) return 0;
+	bool is_written = fwrite(buffer, size, 1, file) == 1;
+	is_written = (fclose(file) == 0) && is_written;
+	return is_written;
+}
+
+static void save_test_break(byte* buffer, int32 save_break) {
+	//the saved children of the root hold their offset into the file in place of mem
+	Game* game = cast(Game*, buffer + SAVE_ALIGN);
+	if(save_break == SAVE_BREAK_GRID_W) {
+		game->grid_w = 1;
+	} else if(save_break == SAVE_BREAK_GRID_DESC) {
+		game->grid_desc.alloc_size -= sizeof(int32);
+	} else if(save_break == SAVE_BREAK_HISTORY_SIZE) {
+		History* history = cast(History*, buffer + cast(inta, game->history_desc.mem));
+		history->size = history->capacity + 1;
+	} else if(save_break == SAVE_BREAK_WALL_SIZE) {
+		Wall* wall = cast(Wall*, buffer + cast(inta, game->wall_desc.mem));
+		wall->size = -1;
+	} else if(save_break == SAVE_BREAK_MAGIC) {
+		cast(SaveHeader*, buffer)->magic = 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	board_init_tables();
+	grid_init();
+	GameMemDesc game_desc = game_new(DEFAULT_SEED, BOARD_SIZE, BOARD_SIZE);
+	inta size = save_size(&game_desc);
+	byte* buffer = malloct(byte, size);
+	int32 failures = 0;
+	for_each_lt(save_break, SAVE_BREAKS_SIZE) {
+		memzero(buffer, size);
+		save_to_buffer(&game_desc, buffer, size);
+		save_test_break(buffer, save_break);
+		if(!save_test_write(buffer, size)) {
+			printf("Could not write save file: %s\n", SAVE_TEST_FILENAME);
+			return 1;
+		}
+		GameMemDesc loaded_desc = {};
+		bool is_loaded = game_load(SAVE_TEST_FILENAME, &loaded_desc);
+		bool is_expected = is_loaded == (save_break == SAVE_BREAK_NONE);
+		printf("broken %s: %s, %s\n", SAVE_BREAK_NAMES[save_break], is_loaded ? "loaded" : "refused", is_expected ? "ok" : "FAILED");
+		if(is_loaded) game_free_recursively(&loaded_desc);
+		if(!is_expected) failures += 1;
+	}
+	free(buffer);
+	game_free_recursively(&game_desc);
+	remove(SAVE_TEST_FILENAME);
+	return failures ? 1 : 0;
+}
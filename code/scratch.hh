@@ -0,0 +1,74 @@
+// Scratch memory for any thread. Every thread that asks for scratch gets a
+// vstack of its own, found through a thread local slot, so a function on a
+// job worker can take temporary memory without malloc and without touching
+// any other thread's. Scratch is taken in scopes: a scope remembers how big
+// its thread's stack was when it opened and puts it back to that when it
+// closes, so scopes nest freely as long as each one only pushes while it is
+// the innermost open one.
+//
+//	scratch_scope(mark) {
+//		int32* cells = scratch_pusht(int32, mark, cells_size);
+//		...
+//	}
+//
+// A break or return out of a scratch_scope skips its close and leaves its
+// memory on the stack until an enclosing scope closes, code that leaves
+// early should use scratch_begin and scratch_end instead.
+
+const inta SCRATCH_STACK_SIZE = 64*MEGABYTE;//reserved per thread, see vstack.hh
+const int SCRATCH_THREADS_MAX = 128;
+
+typedef struct ScratchMark {
+	MamStack* stack;// 0 once the scope is closed
+	inta size;// of the stack when the scope opened
+} ScratchMark;
+
+static bool scratch__is_init;// a thread_tls_t of 0 can be valid
+static thread_tls_t scratch__tls;
+static MamStack* scratch__stacks[SCRATCH_THREADS_MAX];// every thread's stack, so they can all be freed at the end
+static thread_atomic_int_t scratch__stacks_size;
+
+
+void scratch_init() {
+	//must be called before any thread takes scratch
+	scratch__tls = thread_tls_create();
+	scratch__is_init = 1;
+}
+void scratch_term() {
+	//frees every thread's stack, no thread may use scratch after this
+	if(!scratch__is_init) return;
+	int32 stacks_size = min(thread_atomic_int_load(&scratch__stacks_size), SCRATCH_THREADS_MAX);
+	for_each_lt(i, stacks_size) vstack_free(scratch__stacks[i]);
+	thread_atomic_int_store(&scratch__stacks_size, 0);
+	thread_tls_destroy(scratch__tls);
+	scratch__is_init = 0;
+}
+
+MamStack* scratch_stack() {
+	//the calling thread's stack, made the first time the thread asks for it
+	MamStack* stack = cast(MamStack*, thread_tls_get(scratch__tls));
+	if(!stack) {
+		int32 i = thread_atomic_int_inc(&scratch__stacks_size);
+		if(i >= SCRATCH_THREADS_MAX) {
+			MAM_ERRORL("Too many threads asked for scratch memory");
+		}
+		stack = vstack_new(SCRATCH_STACK_SIZE);
+		scratch__stacks[i] = stack;
+		thread_tls_set(scratch__tls, stack);
+	}
+	return stack;
+}
+
+static inline ScratchMark scratch_begin() {
+	ScratchMark mark;
+	mark.stack = scratch_stack();
+	mark.size = mark.stack->size;
+	return mark;
+}
+static inline void scratch_end(ScratchMark* mark) {
+	mam_stack_set_size(mark->stack, mark->size);
+	mark->stack = 0;
+}
+#define scratch_push(mark, size) vstack_push((mark).stack, size)
+#define scratch_pusht(type, mark, size) ((type*)scratch_push(mark, sizeof(type)*(size)))
+#define scratch_scope(mark) for(ScratchMark mark = scratch_begin(); mark.stack; scratch_end(&mark))
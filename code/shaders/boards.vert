@@ -0,0 +1,39 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 colors[16];
+    vec4 boards_layout;
+} ubo;
+
+//one instance per board, the 64 bit board split in 2, cell i is the exponent in bits 4*i to 4*i + 3
+layout(location = 0) in uvec2 inBoard;
+
+layout(location = 0) out vec3 fragColor;
+
+const vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(1.0, 1.0), vec2(0.0, 1.0), vec2(0.0, 0.0));
+
+void main() {
+    //every 6 vertices are the 2 triangles of one cell's square, in the same order game_render pushes squares in
+    int cell = gl_VertexIndex/6;
+    vec2 corner = corners[gl_VertexIndex%6];
+    float board_l = ubo.boards_layout.x;
+    float cell_pitch = ubo.boards_layout.y;
+    float cell_l = ubo.boards_layout.z;
+    float columns = ubo.boards_layout.w;
+
+    float board_i = float(gl_InstanceIndex);
+    float board_y = floor(board_i/columns);
+    vec2 board_pos = board_l*vec2(board_i - board_y*columns, board_y);
+    float margin = (board_l - 4.0*cell_pitch + cell_pitch - cell_l)/2.0;
+    vec2 cell_pos = cell_pitch*vec2(cell%4, cell/4);
+
+    uint half_board = (cell < 8) ? inBoard.x : inBoard.y;
+    uint exponent = (half_board >> (4*(cell%8))) & 15u;
+
+    gl_Position = ubo.model*vec4(board_pos + margin + cell_pos + corner*cell_l, 0.0, 1.0);
+    fragColor = ubo.colors[exponent].rgb;
+}
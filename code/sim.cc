@@ -0,0 +1,230 @@
+// Headless batched simulator. Plays huge numbers of games with moves chosen
+// uniformly among the legal ones on every core and writes each game's result
+// to a compact binary file for offline analysis. It shares board.hh with the
+// game, so moves and spawns follow exactly the same rules, and it depends on
+// neither SDL nor Vulkan.
+//
+// usage: sim [games] [--seed N] [--out file] [--threads N] [--four-chance P]
+//
+// --four-chance replaces the game's even odds between a 2 and a 4 with a 4
+// of probability P, for trying out spawn rule variants.
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+
+#define min gb_min
+#define max gb_max
+
+#include "board.hh"
+#include "jobs.hh"
+
+const uint32 SIM_MAGIC = tobyte32('g', 's', 'i', 'm');
+const uint32 SIM_VERSION = 1;
+const int SIM_BATCH_SIZE = 256;//games stepped together by one task
+const int SIM_BATCHES_PER_ROUND = 256;//a round's results are written out in game order before the next round starts
+const int64 SIM_DEFAULT_GAMES = 1000000;
+
+typedef struct SimHeader {
+	uint32 magic;
+	uint32 version;
+	uint64 seed;
+	uint64 games_total;
+	float four_chance;// negative when the game's own spawn rule was used
+	uint32 record_size;
+} SimHeader;
+
+typedef struct SimRecord {
+	uint32 score;
+	uint32 moves;
+	uint8 max_exponent;
+	uint8 pad[3];
+} SimRecord;
+
+typedef struct SimBatch {
+	//the games of a batch are stored as parallel arrays, finished games are swapped out of the live range at the front
+	int32 live_size;
+	Board boards[SIM_BATCH_SIZE];
+	uint32 scores[SIM_BATCH_SIZE];
+	uint32 moves[SIM_BATCH_SIZE];
+	int32 game_is[SIM_BATCH_SIZE];
+	PCG rngs[SIM_BATCH_SIZE];
+} SimBatch;
+
+typedef struct SimWorker {
+	SimBatch batch;
+	int64 moves;
+	byte pad[64];
+} SimWorker;
+
+typedef struct Sim {
+	JobPool* jobs;
+	uint64 seed;
+	float four_chance;
+	int64 games_total;
+	int64 round_game_start;
+	int32 round_games_size;
+	SimRecord* round_records;
+	SimWorker workers[JOB_WORKERS_MAX];
+} Sim;
+
+
+static Board sim_spawn(Sim* sim, Board board, PCG* rng) {
+	if(sim->four_chance < 0) return board_spawn(board, rng);
+	Board empty = board_empty_mask(board);
+	int32 empty_size = __builtin_popcountll(empty);
+	if(empty_size == 0) return board;
+	int32 n = pcg_random_in(rng, 0, empty_size - 1);
+	Board tile = (pcg_random_uniform(rng) < sim->four_chance) ? 2 : 1;
+	return board | (tile << board_select_bit(empty, n));
+}
+
+static Board sim_new_game(Sim* sim, PCG* rng) {
+	//one tile like the game, with a custom four chance it is placed the way every other spawn is
+	if(sim->four_chance < 0) return board_new_game(rng);
+	return sim_spawn(sim, 0, rng);
+}
+
+static void sim_batch_task(void* data, int32 task_i, int32 worker_i) {
+	Sim* sim = (Sim*)data;
+	SimWorker* worker = &sim->workers[worker_i];
+	SimBatch* batch = &worker->batch;
+	int32 round_i0 = task_i*SIM_BATCH_SIZE;
+	int32 games_size = min(SIM_BATCH_SIZE, sim->round_games_size - round_i0);
+	if(games_size <= 0) return;
+
+	for_each_lt(i, games_size) {
+		int32 round_i = round_i0 + i;
+		//every game gets its own stream, so results don't depend on how games were split between threads
+		pcg_seeds(&batch->rngs[i], sim->seed, sim->round_game_start + round_i);
+		batch->boards[i] = sim_new_game(sim, &batch->rngs[i]);
+		batch->scores[i] = 0;
+		batch->moves[i] = 0;
+		batch->game_is[i] = round_i;
+	}
+	batch->live_size = games_size;
+
+	int64 moves = 0;
+	while(batch->live_size > 0) {
+		for(int32 i = 0; i < batch->live_size;) {
+			Board board = batch->boards[i];
+			PCG* rng = &batch->rngs[i];
+			Board moved;
+			int32 move = board_random_move(board, rng, &moved);
+			if(move != MOVE_NONE) {
+				batch->scores[i] += board_move_score(board, move);
+				batch->moves[i] += 1;
+				batch->boards[i] = sim_spawn(sim, moved, rng);
+				moves += 1;
+				i += 1;
+			} else {
+				SimRecord* record = &sim->round_records[batch->game_is[i]];
+				record->score = batch->scores[i];
+				record->moves = batch->moves[i];
+				record->max_exponent = board_max_exponent(board);
+				memzero(record->pad, 3);
+
+				int32 last = batch->live_size - 1;
+				batch->boards[i] = batch->boards[last];
+				batch->scores[i] = batch->scores[last];
+				batch->moves[i] = batch->moves[last];
+				batch->game_is[i] = batch->game_is[last];
+				batch->rngs[i] = batch->rngs[last];
+				batch->live_size = last;
+			}
+		}
+	}
+	worker->moves += moves;
+}
+
+
+int main(int argc, char** argv) {
+	int64 games_total = SIM_DEFAULT_GAMES;
+	uint64 seed = 12;
+	const char* out_filename = "sim.bin";
+	int32 threads = -1;
+	float four_chance = -1;
+	for_each_in_range(i, 1, argc - 1) {
+		MamString arg = mam_tostr(argv[i]);
+		if(mam_cstreq(arg, "--seed") && i + 1 < argc) {
+			mam_strtouint64(mam_tostr(argv[i + 1]), &seed);
+			i += 1;
+		} else if(mam_cstreq(arg, "--out") && i + 1 < argc) {
+			out_filename = argv[i + 1];
+			i += 1;
+		} else if(mam_cstreq(arg, "--threads") && i + 1 < argc) {
+			mam_strtoint32(mam_tostr(argv[i + 1]), &threads);
+			i += 1;
+		} else if(mam_cstreq(arg, "--four-chance") && i + 1 < argc) {
+			four_chance = gb_clamp01(atof(argv[i + 1]));
+			i += 1;
+		} else {
+			games_total = max(atoll(argv[i]), 1ll);
+		}
+	}
+	if(threads < 1) threads = jobs_cpu_count();
+
+	FILE* file = fopen(out_filename, "wb");
+	if(!file) {
+		printf("Could not open %s for writing\n", out_filename);
+		return 1;
+	}
+	board_init_tables();
+
+	Sim* sim = malloct(Sim, 1);
+	memzero(sim, 1);
+	sim->seed = seed;
+	sim->four_chance = four_chance;
+	sim->games_total = games_total;
+	sim->round_records = malloct(SimRecord, SIM_BATCH_SIZE*SIM_BATCHES_PER_ROUND);
+	JobPool* jobs = malloct(JobPool, 1);
+	jobs_init(jobs, threads - 1);
+	sim->jobs = jobs;
+
+	SimHeader header = {};
+	header.magic = SIM_MAGIC;
+	header.version = SIM_VERSION;
+	header.seed = seed;
+	header.games_total = games_total;
+	header.four_chance = four_chance;
+	header.record_size = sizeof(SimRecord);
+	fwrite(&header, sizeof(SimHeader), 1, file);
+
+	double score_sum = 0;
+	int64 max_exponent_counts[BOARD_EXPONENT_MAX + 1] = {};
+	double t0 = jobs_time();
+	for(int64 game_start = 0; game_start < games_total; game_start += SIM_BATCH_SIZE*SIM_BATCHES_PER_ROUND) {
+		sim->round_game_start = game_start;
+		sim->round_games_size = min(games_total - game_start, cast(int64, SIM_BATCH_SIZE*SIM_BATCHES_PER_ROUND));
+		int32 batches = (sim->round_games_size + SIM_BATCH_SIZE - 1)/SIM_BATCH_SIZE;
+		jobs_run(jobs, sim_batch_task, sim, batches);
+
+		fwrite(sim->round_records, sizeof(SimRecord), sim->round_games_size, file);
+		for_each_in(SimRecord, record, sim->round_records, sim->round_games_size) {
+			score_sum += record->score;
+			max_exponent_counts[record->max_exponent] += 1;
+		}
+	}
+	double time = jobs_time() - t0;
+	fclose(file);
+
+	int64 moves = 0;
+	for_each_lt(i, jobs_workers_total(jobs)) moves += sim->workers[i].moves;
+	printf("%lld games, %lld moves in %.3fs on %d threads: %.1fM moves per second\n", cast(long long, games_total), cast(long long, moves), time, jobs_workers_total(jobs), moves/time/1000000.0);
+	printf("mean score %.1f\n", score_sum/games_total);
+	for_each_lt(e, BOARD_EXPONENT_MAX + 1) {
+		if(max_exponent_counts[e]) printf("max tile %5d: %6.3f%%\n", 1 << e, 100.0*max_exponent_counts[e]/games_total);
+	}
+	printf("results written to %s\n", out_filename);
+
+	jobs_term(jobs);
+	free(jobs);
+	free(sim->round_records);
+	free(sim);
+	return 0;
+}
@@ -0,0 +1,329 @@
+// Expectimax search over 4x4 bitboards. Max nodes try every move, chance
+// nodes average over every spawn, and leaves are scored by a heuristic built
+// from per row tables like the move tables in board.hh. The root and its
+// chance layer are split into tasks that run on the job pool, below that each
+// task searches serially and shares results with the others through a lock
+// free transposition table. The table is keyed by board_canonical, the
+// heuristic scores every row and column the same both ways around so a
+// board's value is the same in all 8 of its symmetries, and one entry serves
+// all of them. solver_search deepens until its time budget runs
+// out and returns the best move of the deepest search that finished, but
+// always finishes SOLVER_DEPTH_MIN first, however long that takes.
+// solver_start runs the same search on the solver's own thread so the frame
+// doesn't wait on it, and solver_poll picks up its result a few frames later.
+// The table is hit at random by every node, so it is put on huge pages
+// where the system has them, see huge.hh.
+
+const int SOLVER_DEPTH_MAX = 16;
+const int SOLVER_DEPTH_MIN = 6;//shallower searches lose too many games to be worth a hint
+const int SOLVER_TASKS_MAX = 4*BOARD_CELLS*2;//every move times every spawn on the board it leaves
+const int SOLVER_NODES_PER_CLOCK_CHECK = 256;
+const float SOLVER_PROB_CUTOFF = 0.0001f;//chance branches less likely than this are scored by the heuristic instead of searched
+const float SOLVER_BRANCHING_ESTIMATE = 4.0f;//how much longer we assume the next depth will take than the last
+
+const float SOLVER_HEUR_LOST_PENALTY = 200000.0f;
+const float SOLVER_HEUR_MONOTONICITY_POWER = 4.0f;
+const float SOLVER_HEUR_MONOTONICITY_WEIGHT = 47.0f;
+const float SOLVER_HEUR_SUM_POWER = 3.5f;
+const float SOLVER_HEUR_SUM_WEIGHT = 11.0f;
+const float SOLVER_HEUR_MERGES_WEIGHT = 700.0f;
+const float SOLVER_HEUR_EMPTY_WEIGHT = 270.0f;
+
+static float solver_row_heuristic_table[BOARD_ROWS_TOTAL];
+
+typedef struct SolverEntry {
+	//written and read without locks, check is key^data so an entry torn by a racing write fails to match instead of returning garbage
+	uint64 check;
+	uint64 data;// float bits of the value in the low 32 bits, the depth it was searched to in the next 8
+} SolverEntry;
+
+typedef struct SolverWorker {
+	int64 nodes;
+	byte pad[56];// keeps each worker's counter on its own cache line
+} SolverWorker;
+
+typedef struct SolverResult {
+	int32 move;// MOVE_NONE when no move changes the board
+	int32 depth;// deepest search that finished
+	float value;
+	int64 nodes;
+	double time;
+} SolverResult;
+
+typedef enum SolverState {
+	SOLVER_STATE_IDLE,
+	SOLVER_STATE_BUSY,// searching on the solver's thread
+	SOLVER_STATE_DONE,// until solver_poll takes the result
+} SolverState;
+
+typedef struct Solver {
+	JobPool* jobs;
+	int32 table_mask;
+	SolverEntry* table;
+	int32 table_backing;// a HugeBacking
+	uint64 deadline;
+	thread_atomic_int_t abort;
+	thread_atomic_int_t cancel;
+
+	//the search solver_start hands to the solver's thread
+	thread_ptr_t thread;
+	thread_signal_t start;
+	thread_atomic_int_t state;// a SolverState
+	thread_atomic_int_t quit;
+	Board search_board;
+	double search_budget;
+	SolverResult search_result;
+	SolverWorker workers[JOB_WORKERS_MAX];
+
+	//the current iteration's root tasks, one per (move, spawn cell, spawn tile)
+	int32 depth;
+	int32 tasks_size;
+	int32 task_moves[SOLVER_TASKS_MAX];
+	Board task_boards[SOLVER_TASKS_MAX];
+	float task_probs[SOLVER_TASKS_MAX];
+	float task_values[SOLVER_TASKS_MAX];
+} Solver;
+
+
+static void solver__init_tables() {
+	for_each_lt(row, BOARD_ROWS_TOTAL) {
+		uint32 line[BOARD_SIZE];
+		for_each_lt(i, BOARD_SIZE) line[i] = (row >> (4*i)) & 0xf;
+
+		float sum = 0;
+		int32 empty = 0;
+		int32 merges = 0;
+		uint32 prev = 0;
+		int32 counter = 0;
+		for_each_lt(i, BOARD_SIZE) {
+			uint32 rank = line[i];
+			sum += pow(rank, SOLVER_HEUR_SUM_POWER);
+			if(rank == 0) {
+				empty += 1;
+			} else {
+				if(prev == rank) {
+					counter += 1;
+				} else if(counter > 0) {
+					merges += 1 + counter;
+					counter = 0;
+				}
+				prev = rank;
+			}
+		}
+		if(counter > 0) merges += 1 + counter;
+
+		float monotonicity_left = 0;
+		float monotonicity_right = 0;
+		for_each_in_range(i, 1, BOARD_SIZE - 1) {
+			float a = pow(line[i - 1], SOLVER_HEUR_MONOTONICITY_POWER);
+			float b = pow(line[i], SOLVER_HEUR_MONOTONICITY_POWER);
+			if(line[i - 1] > line[i]) {
+				monotonicity_left += a - b;
+			} else {
+				monotonicity_right += b - a;
+			}
+		}
+
+		solver_row_heuristic_table[row] = SOLVER_HEUR_LOST_PENALTY
+			+ SOLVER_HEUR_EMPTY_WEIGHT*empty
+			+ SOLVER_HEUR_MERGES_WEIGHT*merges
+			- SOLVER_HEUR_MONOTONICITY_WEIGHT*min(monotonicity_left, monotonicity_right)
+			- SOLVER_HEUR_SUM_WEIGHT*sum;
+	}
+}
+static float solver_heuristic(Board board) {
+	Board t = board_transpose(board);
+	float ret = 0;
+	for_each_lt(i, BOARD_SIZE) {
+		ret += solver_row_heuristic_table[board_row(board, i)];
+		ret += solver_row_heuristic_table[board_row(t, i)];
+	}
+	return ret;
+}
+
+static bool solver__lookup(Solver* solver, Board key, int32 depth, float* ret_value) {
+	SolverEntry* entry = &solver->table[pcgf__hash64(key) & solver->table_mask];
+	uint64 check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+	uint64 data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+	if((check ^ data) != key || cast(int32, (data >> 32) & 0xff) < depth) return 0;
+	uint32 bits = cast(uint32, data);
+	memcpy(ret_value, &bits, sizeof(float));
+	return 1;
+}
+static void solver__store(Solver* solver, Board key, int32 depth, float value) {
+	SolverEntry* entry = &solver->table[pcgf__hash64(key) & solver->table_mask];
+	uint32 bits;
+	memcpy(&bits, &value, sizeof(float));
+	uint64 data = bits | (cast(uint64, depth) << 32);
+	__atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+static float solver__max_node(Solver* solver, SolverWorker* worker, Board board, int32 depth, float prob);
+static float solver__chance_node(Solver* solver, SolverWorker* worker, Board board, int32 depth, float prob) {
+	if(depth <= 0 || prob < SOLVER_PROB_CUTOFF) return solver_heuristic(board);
+	float value;
+	Board key = board_canonical(board);
+	if(solver__lookup(solver, key, depth, &value)) return value;
+
+	worker->nodes += 1;
+	if(worker->nodes%SOLVER_NODES_PER_CLOCK_CHECK == 0 && (SDL_GetPerformanceCounter() > solver->deadline || thread_atomic_int_load(&solver->cancel))) {
+		thread_atomic_int_store(&solver->abort, 1);
+	}
+	if(thread_atomic_int_load(&solver->abort)) return 0;
+
+	Board empty = board_empty_mask(board);
+	int32 empty_size = __builtin_popcountll(empty);
+	float child_prob = prob/(2*empty_size);
+	float sum = 0;
+	while(empty) {
+		int32 shift = __builtin_ctzll(empty);
+		empty &= empty - 1;
+		sum += solver__max_node(solver, worker, board | (cast(Board, 1) << shift), depth, child_prob);
+		sum += solver__max_node(solver, worker, board | (cast(Board, 2) << shift), depth, child_prob);
+	}
+	value = sum/(2*empty_size);
+	if(!thread_atomic_int_load(&solver->abort)) solver__store(solver, key, depth, value);
+	return value;
+}
+static float solver__max_node(Solver* solver, SolverWorker* worker, Board board, int32 depth, float prob) {
+	//a board with no moves left is lost and scores 0
+	float best = 0;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		Board moved = board_move(board, move);
+		if(moved != board) {
+			best = max(best, solver__chance_node(solver, worker, moved, depth - 1, prob));
+		}
+	}
+	return best;
+}
+
+static void solver__root_task(void* data, int32 task_i, int32 worker_i) {
+	Solver* solver = (Solver*)data;
+	SolverWorker* worker = &solver->workers[worker_i];
+	solver->task_values[task_i] = solver__max_node(solver, worker, solver->task_boards[task_i], solver->depth - 1, solver->task_probs[task_i]);
+}
+
+
+SolverResult solver_search(Solver* solver, Board board, double time_budget);
+static int solver__thread_proc(void* data) {
+	Solver* solver = (Solver*)data;
+	while(1) {
+		thread_signal_wait(&solver->start, THREAD_SIGNAL_WAIT_INFINITE);
+		if(thread_atomic_int_load(&solver->quit)) break;
+		solver->search_result = solver_search(solver, solver->search_board, solver->search_budget);
+		thread_atomic_int_store(&solver->state, SOLVER_STATE_DONE);
+	}
+	return 0;
+}
+
+
+Solver* solver_new(JobPool* jobs, int32 table_size_log2) {
+	int32 table_size = 1 << table_size_log2;
+	Solver* solver = malloct(Solver, 1);
+	memzero(solver, 1);
+	solver->jobs = jobs;
+	solver->table_mask = table_size - 1;
+	//huge_alloc's memory comes zeroed, which is an empty table
+	solver->table = cast(SolverEntry*, huge_alloc(table_size*sizeof(SolverEntry), &solver->table_backing));
+	solver__init_tables();
+	thread_signal_init(&solver->start);
+	solver->thread = thread_create(solver__thread_proc, solver, "solver", THREAD_STACK_SIZE_DEFAULT);
+	return solver;
+}
+void solver_cancel(Solver* solver) {
+	//stops a search solver_start began and throws away its result, after this the job pool is free for others to use
+	if(thread_atomic_int_load(&solver->state) == SOLVER_STATE_IDLE) return;
+	thread_atomic_int_store(&solver->cancel, 1);
+	while(thread_atomic_int_load(&solver->state) != SOLVER_STATE_DONE) thread_yield();
+	thread_atomic_int_store(&solver->cancel, 0);
+	thread_atomic_int_store(&solver->state, SOLVER_STATE_IDLE);
+}
+void solver_free(Solver* solver) {
+	solver_cancel(solver);
+	thread_atomic_int_store(&solver->quit, 1);
+	thread_signal_raise(&solver->start);
+	thread_join(solver->thread);
+	thread_destroy(solver->thread);
+	thread_signal_term(&solver->start);
+	huge_free(solver->table, (solver->table_mask + 1)*sizeof(SolverEntry));
+	free(solver);
+}
+
+SolverResult solver_search(Solver* solver, Board board, double time_budget) {
+	SolverResult result = {};
+	uint64 t0 = SDL_GetPerformanceCounter();
+	uint64 deadline = t0 + cast(uint64, time_budget*SDL_GetPerformanceFrequency());
+	for_each_lt(i, jobs_workers_total(solver->jobs)) solver->workers[i].nodes = 0;
+
+	//the root tasks are the same at every depth, only their results change
+	solver->tasks_size = 0;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		Board moved = board_move(board, move);
+		if(moved == board) continue;
+		Board empty = board_empty_mask(moved);
+		float prob = 1.0f/(2*__builtin_popcountll(empty));
+		while(empty) {
+			int32 shift = __builtin_ctzll(empty);
+			empty &= empty - 1;
+			for_each_in_range(tile, 1, 2) {
+				int32 task_i = solver->tasks_size;
+				solver->task_moves[task_i] = move;
+				solver->task_boards[task_i] = moved | (cast(Board, tile) << shift);
+				solver->task_probs[task_i] = prob;
+				solver->tasks_size += 1;
+			}
+		}
+	}
+	if(solver->tasks_size == 0) return result;
+
+	double last_depth_time = 0;
+	for_each_in_range(depth, 1, SOLVER_DEPTH_MAX) {
+		uint64 depth_t0 = SDL_GetPerformanceCounter();
+		double elapsed = get_delta_time(t0, depth_t0);
+		//depths up to the minimum always run to completion, so there is always an answer and it is never a shallow one
+		if(depth > SOLVER_DEPTH_MIN && elapsed + SOLVER_BRANCHING_ESTIMATE*last_depth_time > time_budget) break;
+		thread_atomic_int_store(&solver->abort, 0);
+		solver->deadline = (depth <= SOLVER_DEPTH_MIN) ? MAX_UINT64 : deadline;
+
+		solver->depth = depth;
+		jobs_run(solver->jobs, solver__root_task, solver, solver->tasks_size);
+		if(thread_atomic_int_load(&solver->abort)) break;
+
+		//each task is one spawn after its move, so a move's value is the mean of its tasks weighted by probability
+		float move_values[MOVE_RIGHT + 1] = {};
+		for_each_lt(task_i, solver->tasks_size) {
+			move_values[solver->task_moves[task_i]] += solver->task_probs[task_i]*solver->task_values[task_i];
+		}
+		result.move = solver->task_moves[0];
+		result.value = move_values[result.move];
+		for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+			if(move_values[move] > result.value) {
+				result.move = move;
+				result.value = move_values[move];
+			}
+		}
+		result.depth = depth;
+		last_depth_time = get_delta_time(depth_t0, SDL_GetPerformanceCounter());
+	}
+	for_each_lt(i, jobs_workers_total(solver->jobs)) result.nodes += solver->workers[i].nodes;
+	result.time = get_delta_time(t0, SDL_GetPerformanceCounter());
+	return result;
+}
+
+bool solver_start(Solver* solver, Board board, double time_budget) {
+	//returns 0 and does nothing while the last search is still running or its result hasn't been taken by solver_poll
+	if(thread_atomic_int_load(&solver->state) != SOLVER_STATE_IDLE) return 0;
+	solver->search_board = board;
+	solver->search_budget = time_budget;
+	thread_atomic_int_store(&solver->state, SOLVER_STATE_BUSY);
+	thread_signal_raise(&solver->start);
+	return 1;
+}
+bool solver_poll(Solver* solver, SolverResult* ret_result) {
+	//returns 1 once for every search solver_start began, when it has finished
+	if(thread_atomic_int_load(&solver->state) != SOLVER_STATE_DONE) return 0;
+	*ret_result = solver->search_result;
+	thread_atomic_int_store(&solver->state, SOLVER_STATE_IDLE);
+	return 1;
+}
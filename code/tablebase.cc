@@ -0,0 +1,433 @@
+// Tablebase generator. Enumerates every state of a small grid that the game
+// can reach from its one tile start, solves them all exactly and writes them
+// to a file the game maps for its hints, see tablebase.hh for the format.
+// Both passes go one layer of equal tile sum at a time with the layer split
+// into chunks on the job pool: the forward pass collects each worker's
+// successors into the next 2 layers, which are sorted and deduplicated once
+// they're reached, and the solving pass goes back from the last layer, where
+// every successor a state needs has already been solved. Neither pass holds
+// more than 3 layers: the forward pass writes every layer's keys to the file
+// as soon as it has them, and the solving pass reads them back a layer at a
+// time and writes its values and moves next to them, so the memory it takes
+// is set by the biggest layer and not by the whole tablebase. It shares
+// board.hh and tablebase.hh with the game and depends on neither SDL nor
+// Vulkan.
+//
+// usage: tablebase [w] [h] [--out file] [--threads N]
+#define MAMLIB_IMPLEMENTATION
+#include "mamlib.h"
+#define PCG_IMPLEMENTATION
+#include "pcg.h"
+#define THREAD_IMPLEMENTATION
+#include "thread.h"
+#define GB_MATH_IMPLEMENTATION
+#include "gb_math.h"
+#include "basic.h"
+
+#define min gb_min
+#define max gb_max
+
+#include "board.hh"
+#include "tablebase.hh"
+#include "jobs.hh"
+
+const int TABLEBASE_CHUNK_SIZE = 4096;//states per task
+
+typedef struct TablebaseKeys {
+	TablebaseKey* keys;
+	int64 size;
+	int64 capacity;
+} TablebaseKeys;
+
+typedef struct TablebaseLayer {
+	//a layer of equal tile sum held in memory, first is where its states start in the file
+	TablebaseKeys keys;
+	float* values;
+	uint8* moves;
+	int64 values_capacity;
+	int64 first;
+} TablebaseLayer;
+
+typedef struct TablebaseWorker {
+	TablebaseKeys next[2];//successors with a tile sum 2 and 4 higher than the layer's
+	int64 next_unique_size;//of both when they were last deduplicated
+	TablebaseKeys chunk[2];//successors of the chunk being expanded
+	TablebaseKeys scratch;
+	byte pad[64];
+} TablebaseWorker;
+
+typedef struct TablebaseGen {
+	JobPool* jobs;
+	TablebaseShape shape;
+	int32 key_bytes;//bytes of a key that can be non zero, the radix sort skips the rest
+
+	FILE* file;
+	TablebaseHeader header;//its offsets past the keys are only known once the forward pass is done
+	int64 states_size;
+	uint64* sum_starts;
+	int32 sums_capacity;
+	TablebaseKeys pending[2];//the next 2 layers, unsorted and with duplicates
+	TablebaseKeys scratch;
+
+	//the layer being expanded or solved, and when solving, the 2 after it that were solved already
+	int32 sum_i;
+	TablebaseLayer layer;
+	TablebaseLayer solved[2];
+	TablebaseWorker workers[JOB_WORKERS_MAX];
+} TablebaseGen;
+
+
+static void keys_reserve(TablebaseKeys* keys, int64 capacity) {
+	if(capacity <= keys->capacity) return;
+	int64 new_capacity = max(capacity, 2*keys->capacity);
+	TablebaseKey* new_keys = cast(TablebaseKey*, realloc(keys->keys, new_capacity*sizeof(TablebaseKey)));
+	if(!new_keys) {
+		printf("Out of memory growing a list of %lld states\n", cast(long long, new_capacity));
+		exit(1);
+	}
+	keys->keys = new_keys;
+	keys->capacity = new_capacity;
+}
+static inline void keys_push(TablebaseKeys* keys, TablebaseKey key) {
+	if(keys->size >= keys->capacity) keys_reserve(keys, keys->size + 1);
+	keys->keys[keys->size] = key;
+	keys->size += 1;
+}
+static void keys_append(TablebaseKeys* keys, TablebaseKeys* src) {
+	keys_reserve(keys, keys->size + src->size);
+	memcopy(keys->keys + keys->size, src->keys, src->size);
+	keys->size += src->size;
+}
+
+static inline void keys_swap(TablebaseKeys* keys0, TablebaseKeys* keys1) {
+	TablebaseKeys keys = *keys0;
+	*keys0 = *keys1;
+	*keys1 = keys;
+}
+
+static void layer_reserve(TablebaseLayer* layer, int64 capacity) {
+	keys_reserve(&layer->keys, capacity);
+	if(capacity <= layer->values_capacity) return;
+	int64 new_capacity = layer->keys.capacity;
+	float* new_values = cast(float*, realloc(layer->values, new_capacity*sizeof(float)));
+	uint8* new_moves = cast(uint8*, realloc(layer->moves, new_capacity));
+	if(new_values) layer->values = new_values;
+	if(new_moves) layer->moves = new_moves;
+	if(!new_values || !new_moves) {
+		printf("Out of memory growing a layer of %lld states\n", cast(long long, new_capacity));
+		exit(1);
+	}
+	layer->values_capacity = new_capacity;
+}
+static inline void layer_swap(TablebaseLayer* layer0, TablebaseLayer* layer1) {
+	TablebaseLayer layer = *layer0;
+	*layer0 = *layer1;
+	*layer1 = layer;
+}
+static void layer_free(TablebaseLayer* layer) {
+	free(layer->keys.keys);
+	free(layer->values);
+	free(layer->moves);
+	memzero(layer, 1);
+}
+
+static void keys_sort_unique(TablebaseKeys* keys, TablebaseKeys* scratch, int32 key_bytes) {
+	//lsd radix sort a byte at a time, then drops the duplicates in place
+	keys_reserve(scratch, keys->size);
+	TablebaseKey* src = keys->keys;
+	TablebaseKey* dst = scratch->keys;
+	for_each_lt(b, key_bytes) {
+		int64 counts[256] = {};
+		int32 shift = 8*b;
+		for_each_lt(i, keys->size) counts[(src[i] >> shift) & 0xff] += 1;
+		int64 total = 0;
+		for_each_lt(d, 256) {
+			int64 count = counts[d];
+			counts[d] = total;
+			total += count;
+		}
+		for_each_lt(i, keys->size) {
+			int32 d = (src[i] >> shift) & 0xff;
+			dst[counts[d]] = src[i];
+			counts[d] += 1;
+		}
+		TablebaseKey* t = src;
+		src = dst;
+		dst = t;
+	}
+	if(src != keys->keys) {
+		//an odd number of passes left the sorted keys in scratch, swap the buffers rather than copying them back
+		int64 size = keys->size;
+		keys_swap(keys, scratch);
+		keys->size = size;
+	}
+	int64 size = 0;
+	for_each_lt(i, keys->size) {
+		if(size == 0 || keys->keys[i] != keys->keys[size - 1]) {
+			keys->keys[size] = keys->keys[i];
+			size += 1;
+		}
+	}
+	keys->size = size;
+}
+
+
+static void tablebase_expand_task(void* data, int32 task_i, int32 worker_i) {
+	TablebaseGen* gen = (TablebaseGen*)data;
+	TablebaseWorker* worker = &gen->workers[worker_i];
+	TablebaseShape* shape = &gen->shape;
+	int64 first = cast(int64, task_i)*TABLEBASE_CHUNK_SIZE;
+	int64 end = min(first + TABLEBASE_CHUNK_SIZE, gen->layer.keys.size);
+	for(int64 i = first; i < end; i += 1) {
+		TablebaseKey key = gen->layer.keys.keys[i];
+		for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+			uint32 score;
+			TablebaseKey moved = tablebase_move(shape, key, move, &score);
+			if(moved == key) continue;
+			TablebaseKey empty = tablebase_empty_mask(shape, moved);
+			while(empty) {
+				int32 bit = __builtin_ctzll(empty);
+				empty &= empty - 1;
+				keys_push(&worker->chunk[0], moved | (cast(TablebaseKey, 1) << bit));
+				keys_push(&worker->chunk[1], moved | (cast(TablebaseKey, 2) << bit));
+			}
+		}
+	}
+	//deduplicating every chunk keeps the pending layers from growing to several times their final size
+	for_each_lt(k, 2) {
+		keys_sort_unique(&worker->chunk[k], &worker->scratch, gen->key_bytes);
+		keys_append(&worker->next[k], &worker->chunk[k]);
+		worker->chunk[k].size = 0;
+	}
+	//chunks still share successors with each other, so whenever the worker's lists have doubled they are deduplicated as a whole too
+	int64 next_size = worker->next[0].size + worker->next[1].size;
+	if(next_size > 2*worker->next_unique_size + 64*TABLEBASE_CHUNK_SIZE) {
+		keys_sort_unique(&worker->next[0], &worker->scratch, gen->key_bytes);
+		keys_sort_unique(&worker->next[1], &worker->scratch, gen->key_bytes);
+		worker->next_unique_size = worker->next[0].size + worker->next[1].size;
+	}
+}
+
+static float tablebase_value_of(TablebaseLayer* layer, TablebaseKey key) {
+	int64 i = tablebase__search(layer->keys.keys, 0, layer->keys.size, key);
+	return layer->values[i];
+}
+static void tablebase_solve_task(void* data, int32 task_i, int32 worker_i) {
+	TablebaseGen* gen = (TablebaseGen*)data;
+	TablebaseShape* shape = &gen->shape;
+	TablebaseLayer* layer = &gen->layer;
+	int64 first = cast(int64, task_i)*TABLEBASE_CHUNK_SIZE;
+	int64 end = min(first + TABLEBASE_CHUNK_SIZE, layer->keys.size);
+	for(int64 i = first; i < end; i += 1) {
+		TablebaseKey key = layer->keys.keys[i];
+		float best_value = 0;
+		int32 best_move = MOVE_NONE;
+		for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+			uint32 score;
+			TablebaseKey moved = tablebase_move(shape, key, move, &score);
+			if(moved == key) continue;
+			TablebaseKey empty = tablebase_empty_mask(shape, moved);
+			int32 empty_size = __builtin_popcountll(empty);
+			double spawns_sum = 0;
+			while(empty) {
+				int32 bit = __builtin_ctzll(empty);
+				empty &= empty - 1;
+				spawns_sum += tablebase_value_of(&gen->solved[0], moved | (cast(TablebaseKey, 1) << bit));
+				spawns_sum += tablebase_value_of(&gen->solved[1], moved | (cast(TablebaseKey, 2) << bit));
+			}
+			float value = score + spawns_sum/(2*empty_size);
+			if(best_move == MOVE_NONE || value > best_value) {
+				best_value = value;
+				best_move = move;
+			}
+		}
+		layer->values[i] = best_value;
+		layer->moves[i] = best_move;
+	}
+}
+
+
+static bool tablebase_write_at(FILE* file, int64 offset, void* data, inta size) {
+	//the arrays are filled in a layer at a time and out of order, whatever is left between them reads back as zeros
+	if(fseeko(file, offset, SEEK_SET) != 0) return 0;
+	return size == 0 || fwrite(data, size, 1, file) == 1;
+}
+static bool tablebase_read_at(FILE* file, int64 offset, void* data, inta size) {
+	if(fseeko(file, offset, SEEK_SET) != 0) return 0;
+	return size == 0 || fread(data, size, 1, file) == 1;
+}
+
+int main(int argc, char** argv) {
+	int32 w = 3;
+	int32 h = 3;
+	int32 sizes_given = 0;
+	char default_filename[64];
+	const char* out_filename = 0;
+	int32 threads = -1;
+	for_each_in_range(i, 1, argc - 1) {
+		MamString arg = mam_tostr(argv[i]);
+		if(mam_cstreq(arg, "--out") && i + 1 < argc) {
+			out_filename = argv[i + 1];
+			i += 1;
+		} else if(mam_cstreq(arg, "--threads") && i + 1 < argc) {
+			mam_strtoint32(mam_tostr(argv[i + 1]), &threads);
+			i += 1;
+		} else if(sizes_given < 2) {
+			mam_strtoint32(arg, sizes_given == 0 ? &w : &h);
+			sizes_given += 1;
+		}
+	}
+	if(!tablebase_shape_is_valid(w, h)) {
+		printf("Grids of %dx%d can't be solved, both sides have to be between 2 and %d with at most %d cells\n", w, h, TABLEBASE_LINE_MAX, TABLEBASE_CELLS_MAX);
+		return 1;
+	}
+	if(!out_filename) {
+		snprintf(default_filename, 64, TABLEBASE_FILENAME_FORMAT, w, h);
+		out_filename = default_filename;
+	}
+	if(threads < 1) threads = jobs_cpu_count();
+	board_init_tables();
+
+	TablebaseGen* gen = malloct(TablebaseGen, 1);
+	memzero(gen, 1);
+	tablebase_shape_init(&gen->shape, w, h);
+	gen->key_bytes = (4*w*h + 7)/8;
+	gen->file = fopen(out_filename, "w+b");
+	if(!gen->file) {
+		printf("Could not open %s\n", out_filename);
+		free(gen);
+		return 1;
+	}
+	JobPool* jobs = malloct(JobPool, 1);
+	jobs_init(jobs, threads - 1);
+	gen->jobs = jobs;
+
+	//the keys go right after the header, where the forward pass can write them before it knows how many there are
+	TablebaseHeader* header = &gen->header;
+	header->magic = TABLEBASE_MAGIC;
+	header->version = TABLEBASE_VERSION;
+	header->w = w;
+	header->h = h;
+	header->keys_offset = tablebase__align(sizeof(TablebaseHeader));
+	bool is_written = 1;
+
+	double t0 = jobs_time();
+	{//forward pass, layer by layer
+		//the game starts with one tile, a 2 or a 4, anywhere
+		for_each_lt(cell, w*h) {
+			keys_push(&gen->pending[0], cast(TablebaseKey, 1) << (4*cell));
+			keys_push(&gen->pending[1], cast(TablebaseKey, 2) << (4*cell));
+		}
+		gen->sums_capacity = 1024;
+		gen->sum_starts = malloct(uint64, gen->sums_capacity);
+		gen->sum_starts[0] = 0;//no state has a tile sum of 0
+		gen->sum_i = 1;
+		while(is_written && gen->pending[0].size + gen->pending[1].size > 0) {
+			if(gen->sum_i + 1 >= gen->sums_capacity) {
+				gen->sums_capacity *= 2;
+				gen->sum_starts = cast(uint64*, realloc(gen->sum_starts, gen->sums_capacity*sizeof(uint64)));
+			}
+			keys_sort_unique(&gen->pending[0], &gen->scratch, gen->key_bytes);
+			keys_swap(&gen->layer.keys, &gen->pending[0]);
+			gen->pending[0].size = 0;
+			int64 layer_size = gen->layer.keys.size;
+			gen->sum_starts[gen->sum_i] = gen->states_size;
+			is_written = tablebase_write_at(gen->file, header->keys_offset + gen->states_size*sizeof(TablebaseKey), gen->layer.keys.keys, layer_size*sizeof(TablebaseKey));
+			gen->states_size += layer_size;
+
+			jobs_run(jobs, tablebase_expand_task, gen, cast(int32, (layer_size + TABLEBASE_CHUNK_SIZE - 1)/TABLEBASE_CHUNK_SIZE));
+			keys_swap(&gen->pending[0], &gen->pending[1]);
+			gen->pending[1].size = 0;
+			for_each_in(TablebaseWorker, worker, gen->workers, jobs_workers_total(jobs)) {
+				keys_append(&gen->pending[0], &worker->next[0]);
+				keys_append(&gen->pending[1], &worker->next[1]);
+				worker->next[0].size = 0;
+				worker->next[1].size = 0;
+				worker->next_unique_size = 0;
+			}
+			gen->sum_i += 1;
+		}
+		gen->sum_starts[gen->sum_i] = gen->states_size;
+	}
+	double t1 = jobs_time();
+	printf("%lld states with tile sums up to %d found in %.2fs\n", cast(long long, gen->states_size), 2*(gen->sum_i - 1), t1 - t0);
+
+	//the rest of the file's arrays go after the keys
+	int64 states_size = gen->states_size;
+	int32 sums_size = gen->sum_i;
+	header->states_size = states_size;
+	header->sums_size = sums_size;
+	header->values_offset = header->keys_offset + tablebase__align(states_size*sizeof(TablebaseKey));
+	header->moves_offset = header->values_offset + tablebase__align(states_size*sizeof(float));
+	header->sum_starts_offset = header->moves_offset + tablebase__align(states_size);
+
+	double start_value = 0;
+	{//solving pass, from the last layer back
+		//the last 2 layers look for their successors in 2 empty layers past the end, though as the game is over on them they never do
+		for(int32 sum_i = sums_size - 1; is_written && sum_i >= 1; sum_i -= 1) {
+			layer_swap(&gen->solved[1], &gen->solved[0]);
+			layer_swap(&gen->solved[0], &gen->layer);
+			gen->sum_i = sum_i;
+			TablebaseLayer* layer = &gen->layer;
+			layer->first = gen->sum_starts[sum_i];
+			int64 layer_size = gen->sum_starts[sum_i + 1] - layer->first;
+			layer_reserve(layer, layer_size);
+			layer->keys.size = layer_size;
+			if(!tablebase_read_at(gen->file, header->keys_offset + layer->first*sizeof(TablebaseKey), layer->keys.keys, layer_size*sizeof(TablebaseKey))) {
+				is_written = 0;
+				break;
+			}
+			jobs_run(jobs, tablebase_solve_task, gen, cast(int32, (layer_size + TABLEBASE_CHUNK_SIZE - 1)/TABLEBASE_CHUNK_SIZE));
+			is_written = tablebase_write_at(gen->file, header->values_offset + layer->first*sizeof(float), layer->values, layer_size*sizeof(float))
+				&& tablebase_write_at(gen->file, header->moves_offset + layer->first, layer->moves, layer_size);
+		}
+		gen->sum_i = sums_size;
+
+		//the layers of tile sum 2 and 4 are the last 2 solved
+		if(is_written) {
+			for_each_lt(cell, w*h) {
+				//the mean over the 2*w*h equally likely starts
+				start_value += tablebase_value_of(&gen->layer, cast(TablebaseKey, 1) << (4*cell));
+				start_value += tablebase_value_of(&gen->solved[0], cast(TablebaseKey, 2) << (4*cell));
+			}
+			start_value /= 2*w*h;
+		}
+	}
+	double t2 = jobs_time();
+	printf("solved in %.2fs on %d threads, expected score of a new game with perfect play: %.1f\n", t2 - t1, jobs_workers_total(jobs), start_value);
+
+	{//the layer bounds and the header go last, a file cut short anywhere before them fails to map
+		byte zeros[TABLEBASE_ALIGN] = {};
+		inta sum_starts_size = (sums_size + 1)*sizeof(uint64);
+		is_written = is_written
+			&& tablebase_write_at(gen->file, header->sum_starts_offset, gen->sum_starts, sum_starts_size)
+			&& tablebase_write_at(gen->file, header->sum_starts_offset + sum_starts_size, zeros, tablebase__align(sum_starts_size) - sum_starts_size)
+			&& tablebase_write_at(gen->file, 0, header, sizeof(TablebaseHeader));
+		is_written = (fclose(gen->file) == 0) && is_written;
+	}
+	if(is_written) {
+		printf("tablebase written to %s\n", out_filename);
+	} else {
+		printf("Could not write %s\n", out_filename);
+	}
+
+	jobs_term(jobs);
+	free(jobs);
+	free(gen->pending[0].keys);
+	free(gen->pending[1].keys);
+	free(gen->scratch.keys);
+	layer_free(&gen->layer);
+	layer_free(&gen->solved[0]);
+	layer_free(&gen->solved[1]);
+	for_each_lt(i, JOB_WORKERS_MAX) {
+		TablebaseWorker* worker = &gen->workers[i];
+		free(worker->next[0].keys);
+		free(worker->next[1].keys);
+		free(worker->chunk[0].keys);
+		free(worker->chunk[1].keys);
+		free(worker->scratch.keys);
+	}
+	free(gen->sum_starts);
+	free(gen);
+	return is_written ? 0 : 1;
+}
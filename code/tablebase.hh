@@ -0,0 +1,233 @@
+// Exact solutions of the small grids, 3x3, 2x4 and anything else of at most
+// TABLEBASE_CELLS_MAX cells. The tablebase tool enumerates every state that
+// can be reached from the game's one tile start and solves them all by
+// expectimax, and the file it writes is mapped by the game for instant
+// perfect hints.
+// A state is a key of exponent nibbles, cell (x, y) at bits 4*(x + w*y),
+// moved with board.hh's row tables one line at a time. Moves and spawns
+// only ever raise the sum of a board's tiles, by 2 or 4 with each spawn, so
+// the states are stored in layers of equal tile sum, each layer sorted by
+// key. Finding a state is a binary search of the one layer its sum picks
+// out of sum_starts, and every state's successors are in the next 2 layers,
+// which is what lets the tool solve the layers from the last one back.
+//
+// file layout, every array starts on a TABLEBASE_ALIGN boundary at the offset the header gives for it:
+// TablebaseHeader
+// TablebaseKey keys[states_size]
+// float values[states_size]: expected score still to be made from the state with perfect play
+// uint8 moves[states_size]: the move that makes it, MOVE_NONE once the game is over
+// uint64 sum_starts[sums_size + 1]: states with a tile sum of 2*i are the ones from sum_starts[i] up to sum_starts[i + 1]
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const uint32 TABLEBASE_MAGIC = tobyte32('g', 't', 'b', 'l');
+const uint32 TABLEBASE_VERSION = 1;
+const int TABLEBASE_CELLS_MAX = 9;//9 cells of nibbles still fit the 16 bit lines and a 64 bit key with room to spare
+const int TABLEBASE_LINE_MAX = 4;
+const int TABLEBASE_ALIGN = 64;
+#define TABLEBASE_FILENAME_FORMAT "tablebase_%dx%d.bin"//of the tablebase of a w by h grid, the tool writes it and the game looks for it
+
+typedef uint64 TablebaseKey;
+
+typedef struct TablebaseHeader {
+	uint32 magic;
+	uint32 version;
+	int32 w;
+	int32 h;
+	uint64 states_size;
+	int32 sums_size;
+	uint32 pad;
+	uint64 sum_starts_offset;
+	uint64 keys_offset;
+	uint64 values_offset;
+	uint64 moves_offset;
+	byte pad1[8];
+} TablebaseHeader;
+
+typedef struct TablebaseShape {
+	//the cells of every line of a move, ordered from the edge the tiles move towards
+	int32 w;
+	int32 h;
+	int32 lines_size[MOVE_RIGHT + 1];
+	int32 line_size[MOVE_RIGHT + 1];
+	uint8 line_cells[MOVE_RIGHT + 1][TABLEBASE_LINE_MAX][TABLEBASE_LINE_MAX];
+} TablebaseShape;
+
+typedef struct Tablebase {
+	//a mapped tablebase file, header is 0 when nothing is mapped
+	TablebaseHeader* header;
+	inta file_size;
+	TablebaseShape shape;
+	uint64* sum_starts;
+	TablebaseKey* keys;
+	float* values;
+	uint8* moves;
+} Tablebase;
+
+
+static inline inta tablebase__align(inta size) {
+	return (size + TABLEBASE_ALIGN - 1)/TABLEBASE_ALIGN*TABLEBASE_ALIGN;
+}
+
+bool tablebase_shape_is_valid(int32 w, int32 h) {
+	return w >= 2 && h >= 2 && w <= TABLEBASE_LINE_MAX && h <= TABLEBASE_LINE_MAX && w*h <= TABLEBASE_CELLS_MAX;
+}
+void tablebase_shape_init(TablebaseShape* shape, int32 w, int32 h) {
+	memzero(shape, 1);
+	shape->w = w;
+	shape->h = h;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		bool is_row = (move == MOVE_LEFT || move == MOVE_RIGHT);
+		bool is_reversed = (move == MOVE_RIGHT || move == MOVE_DOWN);
+		shape->lines_size[move] = is_row ? h : w;
+		shape->line_size[move] = is_row ? w : h;
+		for_each_lt(k, shape->lines_size[move]) {
+			for_each_lt(i, shape->line_size[move]) {
+				int32 n = is_reversed ? shape->line_size[move] - 1 - i : i;
+				shape->line_cells[move][k][i] = is_row ? n + w*k : k + w*n;
+			}
+		}
+	}
+}
+
+static inline TablebaseKey tablebase_move(TablebaseShape* shape, TablebaseKey key, int32 move, uint32* ret_score) {
+	//lines shorter than 4 are padded with an empty cell at their far end, which no tile ever slides into
+	TablebaseKey moved = key;
+	uint32 score = 0;
+	for_each_lt(k, shape->lines_size[move]) {
+		uint8* cells = shape->line_cells[move][k];
+		uint32 line = 0;
+		for_each_lt(i, shape->line_size[move]) line |= ((key >> (4*cells[i])) & 0xf) << (4*i);
+		uint32 slid = board_row_left_table[line];
+		score += board_row_score_table[line];
+		for_each_lt(i, shape->line_size[move]) {
+			moved &= ~(cast(TablebaseKey, 0xf) << (4*cells[i]));
+			moved |= cast(TablebaseKey, (slid >> (4*i)) & 0xf) << (4*cells[i]);
+		}
+	}
+	*ret_score = score;
+	return moved;
+}
+static inline uint64 tablebase_sum(TablebaseKey key) {
+	uint64 sum = 0;
+	for(; key; key >>= 4) {
+		uint32 e = key & 0xf;
+		if(e) sum += cast(uint64, 1) << e;
+	}
+	return sum;
+}
+static inline TablebaseKey tablebase_empty_mask(TablebaseShape* shape, TablebaseKey key) {
+	//sets the low bit of every empty cell's nibble, like board_empty_mask but only over the shape's cells
+	TablebaseKey cells_mask = (shape->w*shape->h == 16) ? ~cast(TablebaseKey, 0) : ((cast(TablebaseKey, 1) << (4*shape->w*shape->h)) - 1);
+	key |= key >> 2;
+	key |= key >> 1;
+	return ~key & 0x1111111111111111ull & cells_mask;
+}
+bool tablebase_pack(int32* grid, int32 w, int32 h, TablebaseKey* ret_key) {
+	//returns 0 when the grid has a tile a nibble can't hold
+	TablebaseKey key = 0;
+	for_each_lt(i, w*h) {
+		if(grid[i] < 0 || grid[i] > 15) return 0;
+		key |= cast(TablebaseKey, grid[i]) << (4*i);
+	}
+	*ret_key = key;
+	return 1;
+}
+
+
+static void tablebase__unmap(byte* base, inta file_size) {
+	#ifdef _WIN32
+	UnmapViewOfFile(base);
+	#else
+	munmap(base, file_size);
+	#endif
+}
+void tablebase_unmap(Tablebase* tablebase) {
+	if(tablebase->header) tablebase__unmap(cast(byte*, tablebase->header), tablebase->file_size);
+	memzero(tablebase, 1);
+}
+bool tablebase_map(Tablebase* tablebase, const char* filename) {
+	//maps the file read only, the pages are only read in as lookups touch them
+	memzero(tablebase, 1);
+	byte* base = 0;
+	inta file_size = 0;
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		if(GetFileSizeEx(file, &size)) file_size = size.QuadPart;
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+		if(mapping) {
+			base = cast(byte*, MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+	}
+	#else
+	int file = open(filename, O_RDONLY);
+	if(file >= 0) {
+		struct stat info;
+		if(fstat(file, &info) == 0) file_size = info.st_size;
+		if(file_size > 0) {
+			void* mem = mmap(0, file_size, PROT_READ, MAP_SHARED, file, 0);
+			if(mem != MAP_FAILED) base = cast(byte*, mem);
+		}
+		close(file);
+	}
+	#endif
+	if(!base) return 0;
+
+	TablebaseHeader* header = cast(TablebaseHeader*, base);
+	bool is_valid = file_size >= cast(inta, sizeof(TablebaseHeader)) && header->magic == TABLEBASE_MAGIC && header->version == TABLEBASE_VERSION && tablebase_shape_is_valid(header->w, header->h) && header->sums_size > 0;
+	if(is_valid) {
+		uint64 states_size = header->states_size;
+		is_valid = header->sum_starts_offset + (header->sums_size + 1)*sizeof(uint64) <= cast(uint64, file_size)
+			&& header->keys_offset + states_size*sizeof(TablebaseKey) <= cast(uint64, file_size)
+			&& header->values_offset + states_size*sizeof(float) <= cast(uint64, file_size)
+			&& header->moves_offset + states_size <= cast(uint64, file_size);
+	}
+	if(is_valid) {
+		//every lookup trusts the layer bounds, so they are all checked once here
+		uint64* sum_starts = ptr_add(uint64, base, header->sum_starts_offset);
+		is_valid = sum_starts[header->sums_size] == header->states_size;
+		for_each_lt(i, header->sums_size) is_valid = is_valid && sum_starts[i] <= sum_starts[i + 1];
+	}
+	if(!is_valid) {
+		printf("Invalid tablebase file: %s\n", filename);
+		tablebase__unmap(base, file_size);
+		return 0;
+	}
+	tablebase->header = header;
+	tablebase->file_size = file_size;
+	tablebase_shape_init(&tablebase->shape, header->w, header->h);
+	tablebase->sum_starts = ptr_add(uint64, base, header->sum_starts_offset);
+	tablebase->keys = ptr_add(TablebaseKey, base, header->keys_offset);
+	tablebase->values = ptr_add(float, base, header->values_offset);
+	tablebase->moves = ptr_add(uint8, base, header->moves_offset);
+	return 1;
+}
+
+static int64 tablebase__search(TablebaseKey* keys, int64 first, int64 end, TablebaseKey key) {
+	//index of key in the sorted keys from first up to but not including end, -1 if it isn't there
+	int64 last = end;
+	while(first < last) {
+		int64 mid = first + (last - first)/2;
+		if(keys[mid] < key) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	return (first < end && keys[first] == key) ? first : -1;
+}
+int64 tablebase_find(Tablebase* tablebase, TablebaseKey key) {
+	//index of the state, -1 when it isn't in the tablebase
+	uint64 sum_i = tablebase_sum(key)/2;
+	if(!tablebase->header || sum_i >= cast(uint64, tablebase->header->sums_size)) return -1;
+	return tablebase__search(tablebase->keys, tablebase->sum_starts[sum_i], tablebase->sum_starts[sum_i + 1], key);
+}
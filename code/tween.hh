@@ -0,0 +1,166 @@
+// Tile animations. A move is turned into one tween per tile, sliding it from
+// where it was to where it ends up, plus a pop for every merge and for the
+// spawned tile. Tweens are stored as parallel float arrays right after the
+// Tweens header, in the same allocation, and tweens_evaluate computes every
+// tile's position and scale in one branch free pass that the compiler can
+// vectorize, so the renderer only has to turn its output into quads.
+// Positions are in cells, the renderer scales them to pixels.
+
+const float TWEEN_SLIDE_TIME = 0.09f;
+const float TWEEN_POP_TIME = 0.11f;
+const float TWEEN_MERGE_POP = 0.25f;//how much bigger a merged tile gets halfway through its pop
+const float TWEEN_FOREVER = 1e30f;
+
+typedef enum TweenField {
+	TWEEN_FROM_X,
+	TWEEN_FROM_Y,
+	TWEEN_TO_X,
+	TWEEN_TO_Y,
+	TWEEN_DELAY,//time from the start of the animation before the tween shows up and starts moving
+	TWEEN_RATE,//1/duration
+	TWEEN_HIDE,//time from the start of the animation when the tween disappears
+	TWEEN_SCALE_FROM,
+	TWEEN_POP,
+	TWEEN_X,//outputs of tweens_evaluate
+	TWEEN_Y,
+	TWEEN_SCALE,
+	TWEEN_FIELDS_SIZE,
+} TweenField;
+
+typedef struct Tweens {
+	//header of an allocation of tweens_alloc_size bytes, TWEEN_FIELDS_SIZE float arrays of capacity entries follow it and then an int32 array of tile values
+	int32 capacity;
+	int32 size;//0 when nothing is animating
+	float time;
+	float end_time;
+} Tweens;
+
+
+static inline float* tweens_field(Tweens* tweens, int32 field) {
+	return ptr_add(float, tweens, sizeof(Tweens)) + cast(inta, tweens->capacity)*field;
+}
+static inline int32* tweens_values(Tweens* tweens) {
+	return cast(int32*, tweens_field(tweens, TWEEN_FIELDS_SIZE));
+}
+
+inta tweens_alloc_size(int32 capacity) {
+	return sizeof(Tweens) + (sizeof(float)*TWEEN_FIELDS_SIZE + sizeof(int32))*cast(inta, capacity);
+}
+void tweens_init(Tweens* tweens, int32 capacity) {
+	tweens->capacity = capacity;
+	tweens->size = 0;
+	tweens->time = 0;
+	tweens->end_time = 0;
+}
+void tweens_clear(Tweens* tweens) {
+	tweens->size = 0;
+}
+
+static bool tweens__push(Tweens* tweens, float from_x, float from_y, float to_x, float to_y, float delay, float duration, float hide, float scale_from, float pop, int32 value) {
+	if(tweens->size >= tweens->capacity) return 0;
+	int32 i = tweens->size;
+	tweens_field(tweens, TWEEN_FROM_X)[i] = from_x;
+	tweens_field(tweens, TWEEN_FROM_Y)[i] = from_y;
+	tweens_field(tweens, TWEEN_TO_X)[i] = to_x;
+	tweens_field(tweens, TWEEN_TO_Y)[i] = to_y;
+	tweens_field(tweens, TWEEN_DELAY)[i] = delay;
+	tweens_field(tweens, TWEEN_RATE)[i] = 1.0f/duration;
+	tweens_field(tweens, TWEEN_HIDE)[i] = hide;
+	tweens_field(tweens, TWEEN_SCALE_FROM)[i] = scale_from;
+	tweens_field(tweens, TWEEN_POP)[i] = pop;
+	tweens_values(tweens)[i] = value;
+	tweens->size += 1;
+	if(delay + duration > tweens->end_time) tweens->end_time = delay + duration;
+	return 1;
+}
+
+bool tweens_begin_move(Tweens* tweens, int32* grid, int32 w, int32 h, int32 move, bool is_capped) {
+	//grid is the grid before the move, the tiles are followed through the same merge once rules as grid_move
+	//is_capped follows board_move instead, where tiles at BOARD_EXPONENT_MAX don't merge
+	//returns 0 and leaves nothing animating when there are more tiles than fit or none of them move
+	tweens->size = 0;
+	tweens->time = 0;
+	tweens->end_time = 0;
+	bool is_row = (move == MOVE_LEFT || move == MOVE_RIGHT);
+	bool is_reversed = (move == MOVE_RIGHT || move == MOVE_DOWN);
+	int32 lines = is_row ? h : w;
+	int32 line_size = is_row ? w : h;
+	bool moved = 0;
+	for_each_lt(k, lines) {
+		int32 n = 0;
+		int32 last_v = 0;// value of the tile that ended up at n - 1, 0 once it has merged
+		int32 last_tween = 0;
+		for_each_lt(i, line_size) {
+			int32 from = is_reversed ? line_size - 1 - i : i;
+			int32 from_x = is_row ? from : k;
+			int32 from_y = is_row ? k : from;
+			int32 v = grid[from_x + w*from_y];
+			if(!v) continue;
+			bool is_merge = (v == last_v) && (!is_capped || v < BOARD_EXPONENT_MAX);
+			int32 to = is_merge ? n - 1 : n;
+			to = is_reversed ? line_size - 1 - to : to;
+			float to_x = is_row ? to : k;
+			float to_y = is_row ? k : to;
+			moved |= is_merge | (to != from);
+			if(is_merge) {
+				//both halves of the merge slide in and disappear, the merged tile pops up in their place
+				tweens_field(tweens, TWEEN_HIDE)[last_tween] = TWEEN_SLIDE_TIME;
+				bool pushed = tweens__push(tweens, from_x, from_y, to_x, to_y, 0, TWEEN_SLIDE_TIME, TWEEN_SLIDE_TIME, 1, 0, v);
+				pushed &= tweens__push(tweens, to_x, to_y, to_x, to_y, TWEEN_SLIDE_TIME, TWEEN_POP_TIME, TWEEN_FOREVER, 1, TWEEN_MERGE_POP, v + 1);
+				if(!pushed) {
+					tweens->size = 0;
+					return 0;
+				}
+				last_v = 0;
+			} else {
+				last_tween = tweens->size;
+				if(!tweens__push(tweens, from_x, from_y, to_x, to_y, 0, TWEEN_SLIDE_TIME, TWEEN_FOREVER, 1, 0, v)) {
+					tweens->size = 0;
+					return 0;
+				}
+				last_v = v;
+				n += 1;
+			}
+		}
+	}
+	if(!moved) tweens->size = 0;
+	return moved;
+}
+void tweens_add_spawn(Tweens* tweens, int32 x, int32 y, int32 value) {
+	//the spawned tile grows in once everything else has finished sliding
+	if(tweens->size == 0) return;
+	if(!tweens__push(tweens, x, y, x, y, TWEEN_SLIDE_TIME, TWEEN_POP_TIME, TWEEN_FOREVER, 0, 0, value)) tweens->size = 0;
+}
+void tweens_update(Tweens* tweens, float delta) {
+	if(tweens->size == 0) return;
+	tweens->time += delta;
+	if(tweens->time >= tweens->end_time) tweens->size = 0;
+}
+
+static void tweens__evaluate(int32 size, float time, float* __restrict from_x, float* __restrict from_y, float* __restrict to_x, float* __restrict to_y, float* __restrict delay, float* __restrict rate, float* __restrict hide, float* __restrict scale_from, float* __restrict pop, float* __restrict out_x, float* __restrict out_y, float* __restrict out_scale) {
+	//NOTE: keep this loop free of branches and calls, every iteration is independent so it vectorizes at -O3
+	//the arrays are restrict parameters rather than locals of tweens_evaluate, gcc gives up on the loop otherwise
+	for_each_lt(i, size) {
+		//p and q are clamped to [0, 1] with abs, compare and select clamps stop gcc from vectorizing under its default trapping math
+		float p = (time - delay[i])*rate[i];
+		p = 0.5f*(p + fabsf(p));
+		float q = 1.0f - p;
+		q = 0.5f*(q + fabsf(q));
+		p = 1.0f - q;
+		//ease out cubic for the slide, and a parabola that peaks halfway for the pop
+		float e = 1.0f - q*q*q;
+		float visible = cast(float, (time >= delay[i]) & (time < hide[i]));
+		out_x[i] = from_x[i] + (to_x[i] - from_x[i])*e;
+		out_y[i] = from_y[i] + (to_y[i] - from_y[i])*e;
+		out_scale[i] = visible*(scale_from[i] + (1.0f - scale_from[i])*e + 4.0f*pop[i]*p*q);
+	}
+}
+void tweens_evaluate(Tweens* tweens) {
+	//writes TWEEN_X, TWEEN_Y and TWEEN_SCALE of every tween for the current time, a scale of 0 means the tile isn't drawn
+	tweens__evaluate(tweens->size, tweens->time,
+		tweens_field(tweens, TWEEN_FROM_X), tweens_field(tweens, TWEEN_FROM_Y),
+		tweens_field(tweens, TWEEN_TO_X), tweens_field(tweens, TWEEN_TO_Y),
+		tweens_field(tweens, TWEEN_DELAY), tweens_field(tweens, TWEEN_RATE), tweens_field(tweens, TWEEN_HIDE),
+		tweens_field(tweens, TWEEN_SCALE_FROM), tweens_field(tweens, TWEEN_POP),
+		tweens_field(tweens, TWEEN_X), tweens_field(tweens, TWEEN_Y), tweens_field(tweens, TWEEN_SCALE));
+}
@@ -2,6 +2,13 @@
 
 const uint GAME_MEMDESC_TEMP = 0b1;//marks that an allocation does not need to be preserved on save/load
 const uint GAME_MEMDESC_INTERNAL = 0b10;//marks that an allocation is internal to its parent allocation and thus does not require separate memory management
+const uint GAME_MEMDESC_STACK = 0b100;//marks that an allocation is a MamStack, only the part of it in use is saved
+const uint GAME_MEMDESC_MAPPED = 0b1000;//marks that an allocation lives inside a mapped save file and is released with it rather than freed
+const uint GAME_MEMDESC_MAPPING = 0b10000;//marks the root of a mapped save file, freeing it unmaps the whole file
+const uint GAME_MEMDESC_VIRTUAL = 0b100000;//marks a stack made by vstack_new, it only takes up memory as it grows and freeing it releases its reserve
+const uint GAME_MEMDESC_HUGE = 0b1000000;//asks for an allocation on huge pages, it comes from huge_alloc whatever backing it ends up with
+const uint GAME_MEMDESC_HUGE_TRANSPARENT = 0b10000000;//set by alloc_game_mem on a huge allocation that got transparent huge pages
+const uint GAME_MEMDESC_HUGE_EXPLICIT = 0b100000000;//set by alloc_game_mem on a huge allocation that got explicit huge pages
 typedef struct GameMemDesc {
 	void* mem;
 	inta alloc_size;// size in bytes of the memory at mem
@@ -10,21 +17,20 @@ typedef struct GameMemDesc {
 } GameMemDesc;
 
 
+typedef enum Autoplayer {
+	AUTOPLAYER_EXPECTIMAX,
+	AUTOPLAYER_MONTECARLO,
+	AUTOPLAYER_NTUPLE,
+	AUTOPLAYERS_SIZE,
+} Autoplayer;
+
+
 typedef enum GameState {
 	GAME_STATE_2048,
 	GAME_STATE_GAME_OVER,
 } GameState;
 
 
-typedef enum AnimMove {
-	MOVE_NONE,
-	MOVE_UP,
-	MOVE_DOWN,
-	MOVE_LEFT,
-	MOVE_RIGHT,
-} AnimMove;
-
-
 typedef struct Game {
 	union {
 		MamStack* stack;
@@ -34,23 +40,40 @@ typedef struct Game {
 		MamStack* temp_stack;
 		GameMemDesc temp_stack_desc;
 	};
+	union {
+		int32* grid;
+		GameMemDesc grid_desc;
+	};
+	union {
+		int32* grid_scratch;//room for a transposed copy of grid, used by grid_move
+		GameMemDesc grid_scratch_desc;
+	};
+	union {
+		GridEmpty* grid_empty;//bitmask of the grid's empty cells, kept up to date by grid_move and grid_spawn
+		GameMemDesc grid_empty_desc;
+	};
+	union {
+		Tweens* tweens;//animation of the last move, only ever read by game_render
+		GameMemDesc tweens_desc;
+	};
+	union {
+		History* history;//every move of the current game, only kept for bitboard sized grids
+		GameMemDesc history_desc;
+	};
+	union {
+		Wall* wall;//boards played and drawn instead of the game when its size isn't 0
+		GameMemDesc wall_desc;
+	};
 
 	uint32 state;
 	float game_over_timer;
 
 	int32 grid_w;
 	int32 grid_h;
-	int32* grid;
+	Board board;//the authoritative state when the grid is BOARD_SIZE by BOARD_SIZE, grid is then an unpacked copy of it
 	int32 colors_size;
 	gbVec3* colors;
 
-	int32 anim_queue_max_size;//animation data
-	int32 anim_queue_start;
-	int32 anim_queue_end;
-	int32* anim_queue_moves;
-	int32* anim_queue_grids;
-	int32* anim_queue_grid_dist;
-	float anim_t;
 
 	PCG rng;
 	double lifetime;
@@ -65,16 +88,81 @@ typedef struct Game {
 	bool input_right_just_down;
 	bool input_up_just_down;
 	bool input_down_just_down;
+	bool input_hint_just_down;
+	int32 input_history_jump;//move of the history to go to this frame, -1 for none
+	bool autoplay;
+	int32 autoplayer;//which search answers hints and drives autoplay
+	int32 hint_move;//best move the solver found for the current board, MOVE_NONE once the board changes
+	uint32 input_timestamp;//SDL timestamp of the earliest key press this frame, 0 if there was none
 } Game;
 
 typedef struct Output {
 	bool game_quit;
 	bool window_resize;
+	bool display_change;
 	bool do_draw;
+	bool search_move;//the solver should search board this frame and write its answer to hint_move
+	bool save_game;//the game should be written to SAVE_QUICK_FILENAME at the end of this frame
+	bool load_game;//the game should be replaced with the one in SAVE_QUICK_FILENAME at the end of this frame
+	uint32 input_timestamp;//SDL timestamp of the earliest input whose effect is first drawn this frame, 0 if there was none
 } Output;
 
+const int PRESENT_INTERVAL_SAMPLES = 32;
+typedef struct FramePacing {
+	int display_index;
+	double display_time_per_frame;// refresh interval reported by the display mode
+	double measured_time_per_frame;// refresh interval estimated from present timestamps, 0 until enough samples exist
+	uint64 last_present;
+	uint64 last_display_present;// actualPresentTime in nanoseconds of the last present reported by VK_GOOGLE_display_timing
+	double wake_delay;// time to sleep at the start of a vsynced frame so that its work finishes just before the deadline
+	double slack;// smoothed time recent frames were ready before they were needed
+	int32 present_intervals_size;
+	int32 present_intervals_i;
+	double present_intervals[PRESENT_INTERVAL_SAMPLES];
+} FramePacing;
+
+const int LATENCY_SAMPLES = 256;
+typedef struct LatencyStats {
+	int32 samples_size;
+	int32 samples_i;
+	double samples[LATENCY_SAMPLES];// input to present latencies in milliseconds
+} LatencyStats;
 
 
+typedef struct Vertex {
+    gbVec2 pos;
+    gbVec3 color;
+} Vertex;
+
+typedef struct UniformBufferObject {
+    gbMat4 model;
+    gbMat4 view;
+    gbMat4 proj;
+    //only read by the boards pipeline
+    gbVec4 colors[BOARD_EXPONENT_MAX + 1];//by tile exponent
+    gbVec4 boards_layout;//distance between boards, distance between cells, cell size, boards per row
+} UniformBufferObject;
+
+//everything the cpu writes to while building a frame, we keep one of these per frame in flight so the cpu can fill frame N + 1 while the gpu is still reading frame N
+typedef struct MvkFrame {
+	VkCommandBuffer command_buffer;
+	VkBuffer vertex_buffer;
+	VkDeviceMemory vertex_buffer_memory;
+	byte* vertices;//persistently mapped
+	VkBuffer index_buffer;
+	VkDeviceMemory index_buffer_memory;
+	byte* indices;//persistently mapped
+	VkBuffer uniform_buffer;
+	VkDeviceMemory uniform_buffer_memory;
+	UniformBufferObject* uniform;//persistently mapped
+	VkBuffer instance_buffer;
+	VkDeviceMemory instance_buffer_memory;
+	byte* instances;//persistently mapped, one Board per instance of the boards pipeline
+	VkDescriptorSet descriptor_set;
+	uint32 indices_size;
+	uint32 instances_size;
+} MvkFrame;
+
 typedef struct MvkData {
 	MamStack* stack;
 	VkDevice device;
@@ -92,50 +180,55 @@ typedef struct MvkData {
 	VkFramebuffer* frame_buffers;
 	VkRenderPass render_pass;
 	VkPipeline pipeline;
+	VkPipeline boards_pipeline;//draws a whole wall of Boards as one instance each
 	VkCommandPool command_pool;
 	VkSemaphore* image_available_sems;
 	VkSemaphore* render_finished_sems;
 	VkFence* in_flight_fences;
 	VkFence* images_in_flight_fences;
 	VkQueue draw_queue;
-	VkCommandBuffer* command_buffers;
 	VkQueue present_queue;
 	VkPhysicalDevice physical_device;
+	MvkFrame* frames;//MVK_FRAMES_IN_FLIGHT long
 	uint32 vertex_buffer_size;
-	VkBuffer vertex_buffer;
-	VkDeviceMemory vertex_buffer_memory;
 	uint32 index_buffer_size;
-	VkBuffer index_buffer;
-	VkDeviceMemory index_buffer_memory;
-	VkBuffer uniform_buffer;
-	VkDeviceMemory uniform_buffer_memory;
+	uint32 instance_buffer_size;
 	VkDescriptorPool descriptor_pool;
-	VkDescriptorSet* descriptor_sets;
 	uint32 draw_queue_i;
 	uint32 present_queue_i;
 	uint32 shader_stages_size;
 	uint32 swap_chain_size;
 	uinta swap_chain_mem_start;
 	bool device_does_vsync;
+	bool has_display_timing;
+	PFN_vkGetPastPresentationTimingGOOGLE get_past_presentation_timing;
+	uint32 present_id;
 } MvkData;
 
-const int TRASH_PTRS_SIZE = 4;
+typedef Output GameUpdateFunc(Game* game, SDL_Event* events, int32 events_size, double delta);
+typedef void GameRenderFunc(Game* game, double delta, MvkData* mvk, int32 frame_i);
+typedef struct GameModuleApi {
+	//sizes of the structs the game module shares with the executable, a module built with other layouts is refused
+	uint32 game_size;
+	uint32 output_size;
+	uint32 mvk_size;
+	GameUpdateFunc* update;
+	GameRenderFunc* render;
+} GameModuleApi;
+typedef void GameModuleLoadFunc(GameModuleApi* api, MamTrapFunc* trap, void* trap_data);
+
+const int TRASH_PTRS_SIZE = 8;
+struct JobPool;
+struct Solver;
+struct MonteCarlo;
 typedef struct MainTrash {
 	bool sdl_isinit;
+	JobPool* jobs;
+	Solver* solver;
+	MonteCarlo* montecarlo;
 	MvkData* mvk;
 	SDL_Window* window;
 	GameMemDesc game_desc;
 	void* ptrs[TRASH_PTRS_SIZE];
 } MainTrash;
 
-
-typedef struct Vertex {
-    gbVec2 pos;
-    gbVec3 color;
-} Vertex;
-
-typedef struct UniformBufferObject {
-    gbMat4 model;
-    gbMat4 view;
-    gbMat4 proj;
-} UniformBufferObject;
@@ -0,0 +1,122 @@
+// MamStacks backed by reserved virtual memory. vstack_new reserves address
+// space for the whole reserve_size up front without any memory behind it,
+// and pages are only committed as the stack first grows over them, so a
+// stack can be given far more room than it is ever expected to need at the
+// cost of nothing but address space. A plain MamStack that overflows falls
+// back on malloc and leaks, one of these only runs out at the end of its
+// reserve, and that is a fatal error rather than a leak.
+// The MamStack header is the same as a plain one, so everything that reads
+// a MamStack's size works on both, but pushes that can grow the stack have
+// to go through vstack_allocator, which commits before the stack moves.
+// vstack_reset can hand the committed pages back to the system, for stacks
+// whose peak is far above their usual size.
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+const inta VSTACK_COMMIT_SIZE = 64*1024;//stacks are committed in steps of this, so a stack that grows a little at a time doesn't make a system call for every push
+const inta VSTACK_ALLOC_SLACK = 64;//covers what mam_check_allocation and alignment add on top of an allocation's size
+
+typedef struct VStack {
+	//lives right before the MamStack in its reserve
+	inta reserve_size;// of the whole reserve, headers included
+	inta committed_size;// from the start of the reserve
+} VStack;
+
+
+static inline VStack* vstack__header(MamStack* stack) {
+	return ptr_add(VStack, stack, -cast(inta, sizeof(VStack)));
+}
+static inline inta vstack__round(inta size) {
+	return (size + VSTACK_COMMIT_SIZE - 1)/VSTACK_COMMIT_SIZE*VSTACK_COMMIT_SIZE;
+}
+
+static void vstack__commit(MamStack* stack, inta end) {
+	//makes sure the reserve is committed up to end bytes past the start of the MamStack's memory
+	VStack* vstack = vstack__header(stack);
+	inta needed = sizeof(VStack) + sizeof(MamStack) + end;
+	if(needed <= vstack->committed_size) return;
+	if(needed > vstack->reserve_size) {
+		MAM_ERRORL("Virtual stack ran out of its reserved memory");
+	}
+	inta new_committed_size = vstack__round(needed);
+	if(new_committed_size > vstack->reserve_size) new_committed_size = vstack->reserve_size;
+	void* start = ptr_add(void, vstack, vstack->committed_size);
+	inta size = new_committed_size - vstack->committed_size;
+	#ifdef _WIN32
+	bool is_committed = VirtualAlloc(start, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+	#else
+	bool is_committed = mprotect(start, size, PROT_READ | PROT_WRITE) == 0;
+	#endif
+	if(!is_committed) {
+		MAM_ERRORL("Could not commit memory to a virtual stack");
+	}
+	vstack->committed_size = new_committed_size;
+}
+
+MamStack* vstack_new(inta reserve_size) {
+	reserve_size = vstack__round(reserve_size);
+	#ifdef _WIN32
+	void* mem = VirtualAlloc(0, reserve_size, MEM_RESERVE, PAGE_NOACCESS);
+	#else
+	void* mem = mmap(0, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(mem == MAP_FAILED) mem = 0;
+	#endif
+	if(!mem) {
+		MAM_ERRORL("Could not reserve memory for a virtual stack");
+	}
+	VStack* vstack = cast(VStack*, mem);
+	#ifdef _WIN32
+	VirtualAlloc(mem, VSTACK_COMMIT_SIZE, MEM_COMMIT, PAGE_READWRITE);
+	#else
+	mprotect(mem, VSTACK_COMMIT_SIZE, PROT_READ | PROT_WRITE);
+	#endif
+	vstack->reserve_size = reserve_size;
+	vstack->committed_size = VSTACK_COMMIT_SIZE;
+	return mam_stack_init(ptr_add(void, vstack, sizeof(VStack)), reserve_size - sizeof(VStack));
+}
+void vstack_free(MamStack* stack) {
+	VStack* vstack = vstack__header(stack);
+	#ifdef _WIN32
+	VirtualFree(vstack, 0, MEM_RELEASE);
+	#else
+	munmap(vstack, vstack->reserve_size);
+	#endif
+}
+
+void vstack_reset(MamStack* stack, bool do_decommit) {
+	//empties the stack, and with do_decommit gives back every page past the first step of it
+	stack->size = 0;
+	VStack* vstack = vstack__header(stack);
+	if(!do_decommit || vstack->committed_size <= VSTACK_COMMIT_SIZE) return;
+	void* start = ptr_add(void, vstack, VSTACK_COMMIT_SIZE);
+	inta size = vstack->committed_size - VSTACK_COMMIT_SIZE;
+	#ifdef _WIN32
+	VirtualFree(start, size, MEM_DECOMMIT);
+	#else
+	//the pages go back to the system right away, and the protection makes sure they're committed again before they're next touched
+	madvise(start, size, MADV_DONTNEED);
+	mprotect(start, size, PROT_NONE);
+	#endif
+	vstack->committed_size = VSTACK_COMMIT_SIZE;
+}
+
+void* vstack_allocator(MamAllocMode mode, mam_int alloc_size, void* old_ptr, void* allocator_data) {
+	//a MamAllocatorFunc, mam_stack_allocator with the memory committed before the stack grows into it
+	MamStack* stack = cast(MamStack*, allocator_data);
+	if(mode == MAM_MODE_ALLOC || (mode == MAM_MODE_REALLOC && alloc_size)) {
+		//a realloc only ever moves the top of the stack to somewhere below where an alloc would
+		vstack__commit(stack, stack->size + alloc_size + VSTACK_ALLOC_SLACK);
+	}
+	return mam_stack_allocator(mode, alloc_size, old_ptr, allocator_data);
+}
+
+//macros so that with MEMPROF a push is logged where it was made, see memprof.hh
+#define vstack_push(stack, size) mam_gen_malloc(vstack_allocator, stack, size)
+#define vstack_extend(stack, ptr, size) ((void)mam_gen_realloc(vstack_allocator, stack, size, ptr))
+static inline void vstack_set_size(MamStack* stack, inta new_size) {
+	vstack__commit(stack, new_size);
+	mam_stack_set_size(stack, new_size);
+}
+#define vstack_pusht(type, stack, size) ((type*)vstack_push(stack, sizeof(type)*(size)))
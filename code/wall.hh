@@ -0,0 +1,86 @@
+// A wall of independent bitboard games, each one played by a greedy one move
+// lookahead, for watching a lot of games at once and as a stress test of the
+// simulation and the renderer. The boards are one contiguous array right
+// after the Wall header, followed by the rngs and scores of the games, and
+// wall_step moves every board once in a single pass over them. The renderer
+// copies the boards array straight into a frame's instance buffer and draws
+// the whole wall with one instanced draw call.
+// A board whose game is over starts a new game in its next step.
+
+typedef struct Wall {
+	//header of an allocation of wall_alloc_size bytes, size Boards follow it and then size PCGs and size uint32 scores
+	int32 size;
+	int32 pad;
+	int64 games;// finished so far
+	int64 moves;
+	uint32 best_score;
+	uint32 best_exponent;
+} Wall;
+
+
+static inline Board* wall_boards(Wall* wall) {
+	return ptr_add(Board, wall, sizeof(Wall));
+}
+static inline PCG* wall_rngs(Wall* wall) {
+	return ptr_add(PCG, wall_boards(wall), sizeof(Board)*cast(inta, wall->size));
+}
+static inline uint32* wall_scores(Wall* wall) {
+	return ptr_add(uint32, wall_rngs(wall), sizeof(PCG)*cast(inta, wall->size));
+}
+
+inta wall_alloc_size(int32 size) {
+	return sizeof(Wall) + (sizeof(Board) + sizeof(PCG) + sizeof(uint32))*cast(inta, size);
+}
+void wall_init(Wall* wall, int32 size, uint64 seed) {
+	memzero(wall, 1);
+	wall->size = size;
+	Board* boards = wall_boards(wall);
+	PCG* rngs = wall_rngs(wall);
+	uint32* scores = wall_scores(wall);
+	for_each_lt(i, size) {
+		//every board gets its own stream, so a board plays the same games whatever the size of the wall
+		pcg_seeds(&rngs[i], seed, i);
+		boards[i] = board_new_game(&rngs[i]);
+		scores[i] = 0;
+	}
+}
+
+static inline int32 wall__best_move(Board board) {
+	//the move that leaves the most empty cells, ties go to the higher scoring move, MOVE_NONE when no move changes the board
+	int32 best_move = MOVE_NONE;
+	int32 best_value = -1;
+	for_each_in_range(move, MOVE_UP, MOVE_RIGHT) {
+		Board moved = board_move(board, move);
+		if(moved == board) continue;
+		int32 value = (board_count_empty(moved) << 20) + board_move_score(board, move);
+		if(value > best_value) {
+			best_move = move;
+			best_value = value;
+		}
+	}
+	return best_move;
+}
+void wall_step(Wall* wall) {
+	//moves every board once
+	Board* boards = wall_boards(wall);
+	PCG* rngs = wall_rngs(wall);
+	uint32* scores = wall_scores(wall);
+	int64 moves = 0;
+	for_each_lt(i, wall->size) {
+		Board board = boards[i];
+		int32 move = wall__best_move(board);
+		if(move != MOVE_NONE) {
+			scores[i] += board_move_score(board, move);
+			boards[i] = board_spawn(board_move(board, move), &rngs[i]);
+			moves += 1;
+		} else {
+			if(scores[i] > wall->best_score) wall->best_score = scores[i];
+			uint32 exponent = board_max_exponent(board);
+			if(exponent > wall->best_exponent) wall->best_exponent = exponent;
+			wall->games += 1;
+			scores[i] = 0;
+			boards[i] = board_new_game(&rngs[i]);
+		}
+	}
+	wall->moves += moves;
+}
@@ -613,6 +613,7 @@ struct thread_queue_t
 
     #include <pthread.h>
     #include <sys/time.h>
+    #include <errno.h>
 
 #else 
     #error Unknown platform.
@@ -1039,7 +1040,7 @@ void thread_atomic_int_store( thread_atomic_int_t* atomic, int desired )
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
         __sync_lock_test_and_set( &atomic->i, desired );
-        __sync_lock_release( &atomic->i );
+        __sync_synchronize();
     
     #else 
         #error Unknown platform.
@@ -1120,7 +1121,7 @@ int thread_atomic_int_swap( thread_atomic_int_t* atomic, int desired )
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
         int old = (int)__sync_lock_test_and_set( &atomic->i, desired );
-        __sync_lock_release( &atomic->i );
+        __sync_synchronize();
         return old;
     
     #else 
@@ -1176,7 +1177,7 @@ void thread_atomic_ptr_store( thread_atomic_ptr_t* atomic, void* desired )
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
         __sync_lock_test_and_set( &atomic->ptr, desired );
-        __sync_lock_release( &atomic->ptr );
+        __sync_synchronize();
     
     #else 
         #error Unknown platform.
@@ -1198,7 +1199,7 @@ void* thread_atomic_ptr_swap( thread_atomic_ptr_t* atomic, void* desired )
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
         void* old = __sync_lock_test_and_set( &atomic->ptr, desired );
-        __sync_lock_release( &atomic->ptr );
+        __sync_synchronize();
         return old;
     
     #else 
@@ -1308,7 +1309,7 @@ thread_tls_t thread_tls_create( void )
 
         pthread_key_t tls;
         if( pthread_key_create( &tls, NULL ) == 0 )
-            return (thread_tls_t) tls;
+            return (thread_tls_t) (uintptr_t) tls;
         else
             return NULL;
 
@@ -1326,7 +1327,7 @@ void thread_tls_destroy( thread_tls_t tls )
     
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
-        pthread_key_delete( (pthread_key_t) tls );
+        pthread_key_delete( (pthread_key_t) (uintptr_t) tls );
     
     #else 
         #error Unknown platform.
@@ -1342,7 +1343,7 @@ void thread_tls_set( thread_tls_t tls, void* value )
     
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
-        pthread_setspecific( (pthread_key_t) tls, value );
+        pthread_setspecific( (pthread_key_t) (uintptr_t) tls, value );
     
     #else 
         #error Unknown platform.
@@ -1358,7 +1359,7 @@ void* thread_tls_get( thread_tls_t tls )
     
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
-        return pthread_getspecific( (pthread_key_t) tls );
+        return pthread_getspecific( (pthread_key_t) (uintptr_t) tls );
     
     #else 
         #error Unknown platform.